@@ -21,198 +21,2652 @@
 #fuses HS,NOWDT,PUT,NOPROTECT,NOMCLR
 #use delay(clock=20000000)
 
+/* -----------------------------
+ * Pin assignment (PIC16F648A)
+ * -----------------------------
+ * Inputs:
+ *  - CLK_IN   : external clock input for bit sampling
+ *  - DATA_IN  : external data input
+ *  - SW_SEL   : "select / setting" button
+ *  - SW_TRIG  : "trigger / start" button
+ *
+ * Outputs:
+ *  - SYNC_LED : indicates lock/sync status (or general status LED)
+ *
+ * NOTE:
+ * - Clock polarity and Data polarity can be inverted by flags ClockNeg/DataNeg
+ *   (used as XOR masks when sampling).
+ */
+#define CLK_IN    PIN_A4
+#define DATA_IN   PIN_A5
+#define SW_SEL    PIN_A0
+#define SW_TRIG   PIN_A1
+#define SYNC_LED  PIN_A3
+
+/* -----------------------------
+ * Build options
+ * -----------------------------
+ * BERT_ENGINE selects how countber() picks up the CLK_IN edges:
+ *   ENGINE_POLL : busy-wait on CLK_IN in the count loops (original).
+ *   ENGINE_TMR0 : CLK_IN is on RA4/T0CKI, so TMR0 counts the edges in
+ *                 hardware. It is preloaded with 0xFF, every edge
+ *                 overflows it and the bit is processed in #int_rtcc.
+ *                 The main loop is free while a measurement runs.
+ *
+ * NOTE (ENGINE_TMR0):
+ * - DATA_IN is sampled by the ISR, i.e. interrupt latency plus the CCS
+ *   context save after the edge (roughly 25 cycles = 5us @20MHz).
+ *   DATA must stay valid that long after the sampling edge.
+ */
+#define ENGINE_POLL  0
+#define ENGINE_TMR0  1
+
+#define BERT_ENGINE  ENGINE_POLL
+
+/*
+ * PN polynomials compiled in besides PN9 (always present).
+ * Each one adds its own sync/count loops (pn_loop.c) to ROM.
+ */
+#define USE_PN7      TRUE
+#define USE_PN11     TRUE
+#define USE_PN15     TRUE
+#define USE_PN23     TRUE
+
+/*
+ * USE_WORD: POLY_WORD ("Word" in the polynomial menu), any pattern that
+ * repeats within WORD_MAX (64) bits, e.g. a framing word. Sync learns
+ * the period from the line (pn_loop.c with PN_WORD), the count phase
+ * compares against a ring of the learned bits.
+ * Off by default: about 21 bytes of RAM, which the default build does
+ * not have to spare (256 bytes in all, see README). To turn it on,
+ * turn off USE_CAP (about 32 bytes).
+ */
+#define USE_WORD     FALSE
+
+/*
+ * AUTO_POL: sync tries both data polarities on every seed and flips the
+ * clock edge after 256 bytes without lock (pn_loop.c). The polarity that
+ * locked is kept in DataNeg/ClockNeg (shown on the main screen, saved
+ * with both keys). ClockNeg/DataNeg from EEPROM are the first guess.
+ */
+#define AUTO_POL     TRUE
+
+/*
+ * Loss of sync in the count phase: more than LOS_ERRS errors in the last
+ * LOS_WIN bytes (64 bits) means a slip (a slipped PN line gives ~50%).
+ * The run then goes back to sync instead of counting garbage.
+ */
+#define LOS_WIN      8       // bytes, power of 2
+#define LOS_ERRS     16
+
+/*
+ * USE_HIST: log2 histograms of error bursts and of the gaps between them
+ * (rx_byte(), hist_xxx()). Shown after the result with SW_SEL, or sent
+ * with the serial H command.
+ * Off by default: about 43 bytes of RAM (the bins and the open burst),
+ * more than the default build has left (256 bytes in all, see README).
+ * To turn it on, turn off USE_CAP (about 32 bytes) and USE_REP (about
+ * 11) as well.
+ */
+#define USE_HIST     FALSE
+
+/*
+ * USE_TIME: 100ms time base (Timer1 + CCP1), G.821 style seconds
+ * (ES / SES / unavailable) and measurement lengths in minutes.
+ */
+#define USE_TIME     TRUE
+
+/*
+ * USE_RATE: CLK_IN rate (TMR0 external count over a 100ms gate) on the
+ * main screen and the result screen.
+ */
+#define USE_RATE     TRUE
+
+/*
+ * USE_OVR: cross-check the processed bits against TMR0's hardware count
+ * of CLK_IN edges; any difference (missed edge, full RX ring) is an
+ * overrun and the result is shown as "OVERRUN".
+ */
+#define USE_OVR      TRUE
+
+/*
+ * USE_ASM (ENGINE_POLL): the count phase per-bit path is hand-written
+ * #asm with one variant per clock edge (rx_bits_r() / rx_bits_f()).
+ */
+#define USE_ASM      TRUE
+
+/*
+ * USE_PROF (ENGINE_POLL, diagnostics): Timer1 times the edge waits of
+ * the count loop, i.e. the cycles per bit left over by the per-bit and
+ * byte work (prof_init()). Shown after the result with SW_SEL and sent
+ * as a D record. Timer1 then runs free, so USE_TIME is off; the #asm
+ * loops have no room for the reads, so the C loop is the one measured.
+ */
+#define USE_PROF     FALSE
+
+#if BERT_ENGINE != ENGINE_POLL
+#undef  USE_PROF
+#define USE_PROF     FALSE
+#endif
+#if USE_PROF
+#undef  USE_TIME
+#define USE_TIME     FALSE
+#undef  USE_ASM
+#define USE_ASM      FALSE
+#endif
+
+/*
+ * USE_CAP (ENGINE_POLL): MODE_CAP, burst capture for clocks above
+ * RATE_MAX. CAP_LEN bytes of DATA_IN go into RAM at full speed
+ * (cap_fill()), then sync and compare run on the buffer; the bursts
+ * repeat until the length is counted.
+ */
+#define USE_CAP      TRUE
+#define CAP_LEN      32      // bytes per burst (RAM is the limit)
+
+#if BERT_ENGINE != ENGINE_POLL
+#undef  USE_CAP
+#define USE_CAP      FALSE   // capture polls CLK_IN with clk_isr() off
+#endif
+
+/*
+ * USE_GEN (ENGINE_POLL): PN generator on GEN_DATA (RA2).
+ *   MODE_GEN  : send the selected sequence until SW_SEL.
+ *   MODE_LOOP : send it and count DATA_IN against the same bits
+ *               (loopback, one LFSR advance for both directions).
+ * The bit clock is GEN_CLK (RB3) from the firmware, or CLK_IN when
+ * USE_UART gives RB3 to lcd_u.c.
+ */
+#define USE_GEN      TRUE
+
+#if BERT_ENGINE != ENGINE_POLL
+#undef  USE_GEN
+#define USE_GEN      FALSE
+#endif
+
+/*
+ * USE_LANE (ENGINE_POLL): MODE_LANE, four more data lanes on RB4..RB7
+ * sampled on the same CLK_IN edge as DATA_IN, with one PORTB read and
+ * one XOR per clock for all of them (pnX_lane()). DATA_IN stays the
+ * reference lane for sync, loss of sync and the end of the run.
+ * RB4..RB7 are also the LCD data lines, so this needs the lcd_u.c
+ * wiring (USE_UART: R/W tied to GND, the LCD never drives them); the
+ * lanes go in through series resistors (1k) so LCD writes between
+ * runs override them.
+ */
+#define USE_LANE     FALSE
+
+#if BERT_ENGINE != ENGINE_POLL
+#undef  USE_LANE
+#define USE_LANE     FALSE
+#endif
+
+/*
+ * USE_NRZ (ENGINE_POLL): MODE_NRZ, data without a clock. DATA_IN is
+ * sampled NRZ_OVS times per bit on a Timer1 schedule at the nominal
+ * rate of the "NRZ rate" setting; every transition realigns the bit
+ * phase and the sample after the middle of the bit is the received bit
+ * (nrz_bit()). The recovered bits go through the same sync and
+ * rx_byte() as clocked ones (pnX_nrz()). Up to 9600 bit/s.
+ */
+#define USE_NRZ      TRUE
+
+#if BERT_ENGINE != ENGINE_POLL
+#undef  USE_NRZ
+#define USE_NRZ      FALSE
+#endif
+
+/*
+ * USE_INJ: error injection at a known rate (settings menu "Inject").
+ * One bit per tbyte[] period: into the sent byte in MODE_GEN /
+ * MODE_LOOP, into the expected byte (PnExp) otherwise, so countber()
+ * must report the injected BER on a clean line.
+ */
+#define USE_INJ      TRUE
+
+/*
+ * USE_LOG: the last LOG_N results in data EEPROM (log_add()), browsed
+ * from the settings menu ("History").
+ */
+#define USE_LOG      TRUE
+
+/*
+ * USE_EARLY: a BER limit (settings menu "BER limit"). A run then ends
+ * as soon as it is decided against the limit (early_init()) and the
+ * result screen shows PASS / FAIL instead of the length.
+ */
+#define USE_EARLY    TRUE
+
+/*
+ * USE_REP: MODE_REP ("Repeat"), blocks of the set length back to back
+ * until SW_SEL. Each block end only snapshots the counters (rep_block())
+ * and the count goes on with the locked LFSR, so no bit of the line is
+ * left out between blocks. ENGINE_TMR0 shows every snapshot while the
+ * next block runs (rep_step()); ENGINE_POLL below LIVE_MAX as well
+ * (POLL_LIVE), with a faster clock it shows the last full block when
+ * stopped.
+ */
+#define USE_REP      TRUE
+
+/*
+ * POLL_LIVE: the live screens of MODE_CONT and MODE_REP with
+ * ENGINE_POLL, one short step per byte (poll_step()) when the clock
+ * measured at the start is at most LIVE_MAX (needs USE_RATE). A faster
+ * clock shows "Counting..." until the end.
+ */
+#define LIVE_MAX     4800    // Hz, estimate with a 2x margin, see poll_step()
+
+#if USE_RATE && BERT_ENGINE == ENGINE_POLL
+#define POLL_LIVE    TRUE
+#else
+#define POLL_LIVE    FALSE
+#endif
+
+/*
+ * USE_TEST: power-on self-test of the compiled-in PN engines
+ * (self_test()): a CRC of each pnX_next() sequence against pn_crc[].
+ * A mismatch stops the tester before any wrong BER can be shown.
+ */
+#define USE_TEST     TRUE
+
+/*
+ * USE_UART: result records and remote control on the hardware USART
+ * (RB1 = RX, RB2 = TX, BERT_BAUD 8N1). The LCD then moves to lcd_u.c:
+ * RS on RB3 instead of RB1, R/W tied to GND.
+ */
+#define USE_UART     FALSE
+#define BERT_BAUD    19200
+
+/*
+ * USE_SLEEP: after SLEEP_SEC without a key on a UI screen, the PIC goes
+ * to SLEEP until SW_SEL or SW_TRIG (idle_sleep()). The LCD keeps the
+ * screen. Measurements never sleep. Not with USE_UART: the USART
+ * stops with the oscillator.
+ */
+#define USE_SLEEP    TRUE
+#define SLEEP_SEC    60
+
+#if USE_UART
+#undef  USE_SLEEP
+#define USE_SLEEP    FALSE
+#endif
+
+#if USE_LANE && !USE_UART
+#error "USE_LANE: RB4..RB7 are shared with the LCD, needs lcd_u.c (USE_UART)"
+#endif
+
+#if USE_GEN
+#define GEN_DATA  PIN_A2
+#if !USE_UART
+#define GEN_CLK   PIN_B3
+#endif
+#endif
+
+/*
+ * LCD driver:
+ * This project uses CCS's LCD driver variant for PORTB.
+ * Original comment: lcd.c #define use_portb_lcd TRUE  Un-comment ́B
+ */
+#if USE_UART
+#include "lcd_u.c"
+#use rs232(baud=BERT_BAUD, xmit=PIN_B2, rcv=PIN_B1, ERRORS)
+#include "serial.c"
+#else
+#include <lcd_b.c>
+#endif
+
+/*
+ * All screens are written to a RAM shadow of the LCD (printf(fb_putc,...))
+ * and pushed to the LCD driver one character at a time by fb_task().
+ */
+#include "lcd_fb.c"
+
+/* -----------------------------------------
+ * EEPROM default contents (PIC data EEPROM)
+ * -----------------------------------------
+ * CCS: #ROM 0x2100 = {...} sets the initial EEPROM values.
+ *
+ * Address map (read/write):
+ *   0: ClockNeg   (0/1) clock polarity invert flag
+ *   1: DataNeg    (0/1) data polarity invert flag
+ *   2: TBI        (0..11) measurement length: 0..7 = 1E3..1E10 bits,
+ *                 8..11 = 1/15/60/1440 minutes (USE_TIME)
+ *   3: ThresError (int) threshold for sync phase (consecutive "match" count)
+ *   4: Poly       (0..5) PN polynomial (POLY_xxx), 5 = learned word
+ *   5: Mode       (0..7) MODE_BLOCK / MODE_CONT / MODE_CAP / MODE_GEN /
+ *                 MODE_LOOP / MODE_LANE / MODE_NRZ / MODE_REP
+ *   6: InjSel     (0..4) error injection off / 1E-3..1E-6 (USE_INJ)
+ *   7: EarlySel   (0..7) BER limit off / 1E-3..1E-9 (USE_EARLY)
+ *   8: NrzSel     (0..3) MODE_NRZ rate 1200..9600 bit/s (USE_NRZ)
+ *   16..125: result log, LOG_N records of LOG_REC bytes (USE_LOG)
+ *
+ * Note: comment says 16F8X/16F87X/16F62X uses EEPROM from 0x2100.
+ */
+#ROM 0x2100 = {0,0,2,10,1,0,0,0,3}
+
+/* -----------------------------
+ * Globals
+ * ----------------------------- */
+#include "bert_core.h"
+
+/*
+ * Test Bit count Index (TBI)
+ * TotalBytes is selected from tbyte[] by TBI: 1E(TBI+3) bits.
+ * USE_TIME adds lengths in minutes from tmin[] after the bit counts.
+ */
+#define TBI_BITS   8
+
+#if USE_TIME
+#define TBI_COUNT  (TBI_BITS + 4)
+#else
+#define TBI_COUNT  TBI_BITS
+#endif
+
+int  TBI;
+int32 const tbyte[TBI_BITS] = {125, 1250, 12500, 125000,
+                               1250000, 12500000, 125000000, 1250000000};
+#if USE_TIME
+long const tmin[TBI_COUNT - TBI_BITS] = {1, 15, 60, 1440};
+#endif
+
+/*
+ * Measurement mode
+ *   MODE_BLOCK : count TotalBytes, then show_ber() (original behaviour).
+ *   MODE_CONT  : count until SW_SEL is pressed. TotalBytes is 0, so the
+ *                block only "ends" when CountBytes wraps at 2^32 bytes,
+ *                before the counters would overflow.
+ *                With ENGINE_TMR0 the LCD shows the running counters.
+ *   MODE_CAP   : (USE_CAP) counts TotalBytes like MODE_BLOCK, but from
+ *                CAP_LEN-byte bursts of the line (pnX_cap()).
+ *   MODE_GEN   : (USE_GEN) generator only, until SW_SEL (pnX_gen()).
+ *   MODE_LOOP  : (USE_GEN) generator + counting like MODE_BLOCK; DATA_IN
+ *                is compared with the bit just sent, no sync phase.
+ *   MODE_LANE  : (USE_LANE) MODE_BLOCK on DATA_IN, plus per-lane error
+ *                counts of RB4..RB7 (pnX_lane()).
+ *   MODE_NRZ   : (USE_NRZ) MODE_BLOCK without CLK_IN, the bit clock is
+ *                recovered from DATA_IN (pnX_nrz()).
+ *   MODE_REP   : (USE_REP) MODE_BLOCK over and over without a gap, until
+ *                SW_SEL; the result is the last full block.
+ * The numbers are fixed (EEPROM, 'M' command); mode_on[] tells which
+ * are compiled in.
+ */
+#define MODE_BLOCK  0
+#define MODE_CONT   1
+#define MODE_CAP    2
+#define MODE_GEN    3
+#define MODE_LOOP   4
+#define MODE_LANE   5
+#define MODE_NRZ    6
+#define MODE_REP    7
+#define MODE_COUNT  8
+
+int   Mode;
+int const mode_on[MODE_COUNT] = {TRUE, TRUE, USE_CAP, USE_GEN, USE_GEN, USE_LANE, USE_NRZ, USE_REP};
+
+#if USE_REP
+/*
+ * MODE_REP blocks are 10^(RepTbi + 3) bits: tbyte[TBI], or REP_TBI
+ * (1E6 bits) when the length is in minutes.
+ */
+#define REP_TBI     3
+
+int   RepTbi;
+long  RepSeq;                // rep_step(): block number being shown
+int   RepLoss;               // and its re-locks
+#endif
+
+#if USE_INJ
+/*
+ * Error injection (USE_INJ).
+ * InjSel n = 1..4: one flipped bit every tbyte[n-1] bytes, i.e. a BER
+ * of 1E-(n+2). INJ_BYTE(x) is one test per byte while off and a 32-bit
+ * count-down while on; it sits next to every count-phase PN_FN(next)().
+ */
+#define INJ_COUNT   5
+
+int   InjSel;                // 0 = off
+short InjOn;
+int32 InjPer;                // bytes per injected error
+int32 InjLeft;               // bytes until the next one
+
+#define INJ_BYTE(x)  if (InjOn) { if (--InjLeft == 0) { x ^= 0x01; InjLeft = InjPer; } }
+#else
+#define INJ_BYTE(x)
+#endif
+
+#if USE_EARLY
+/*
+ * BER limit (USE_EARLY).
+ * EarlySel n = 1..7: L = 1E-(n+2), so tbyte[n-1] is also the bytes per
+ * error at the limit (early_init()).
+ */
+#define EARLY_COUNT 8
+
+int   EarlySel;              // 0 = off
+char const early_code[3] = {'P', 'F', 'O'};   // R record
+#endif
+#if USE_CAP
+int   CapBuf[CAP_LEN];       // one burst, oldest bit in bit 7 of CapBuf[0]
+#endif
+#if USE_LANE
+#define LANE_N      4
+#define LANE_PINS   0xF0     // RB4..RB7 in PORTB
+
+int32 LaneErr[LANE_N];       // error bits of RB4..RB7
+int   LaneExp;               // expected line bits of the current byte
+#endif
+#if USE_NRZ
+/*
+ * Clock recovery (MODE_NRZ, USE_NRZ), see nrz_bit().
+ * NrzSel picks the nominal rate; nrz_tick[] is the sample period in
+ * instruction cycles, 5MHz / (NRZ_OVS * rate), on Timer1 free running
+ * at 1:1. USE_TIME then counts CCP1 compares of NRZ_CCP cycles instead
+ * of resetting Timer1 (tick_ccp()).
+ */
+#define NRZ_COUNT   4
+#define NRZ_CCP     62500    // 12.5ms, 8 per 100ms tick
+
+int   NrzSel;
+long const nrz_rate[NRZ_COUNT] = {1200, 2400, 4800, 9600};
+long const nrz_tick[NRZ_COUNT] = {1042, 521, 260, 130};
+long  NrzTick;               // nrz_tick[NrzSel]
+long  NrzNext;               // Timer1 at the next sample
+#endif
+
+/*
+ * Live screen (MODE_CONT).
+ * rx_wrap() sets LiveDue every 256 counted bytes (2048 bits). ENGINE_TMR0:
+ * live_step() updates the frame buffer from the idle loop of rx_get() in
+ * small steps, and fb_task() pushes only the digits that changed. No
+ * single step holds the main loop for more than one fmt_ber() (no int32
+ * multiply, about the time of one int32 division) or one LCD character;
+ * RX_RING gives the ISR room for the bits arriving meanwhile.
+ * ENGINE_POLL has no idle time while counting: it gets one short step
+ * per byte as LIVE_POLL() of the count loop while LivePoll (POLL_LIVE,
+ * poll_step()), cont_step() / rep_step() with no division at all.
+ */
+short LiveDue;
+int   LiveStep;              // 0 = idle, 1.. = update in progress
+int32 LiveNum;               // number being converted to decimal
+#if POLL_LIVE
+int32 LiveDen;               // cont_step(): bytes, then the BER divisor
+long  LiveM;                 // cont_step(): BER mantissa digits
+int   LiveE;                 // cont_step(): kbit / Mbit, then the exponent
+short LivePoll;              // this run: MODE_CONT / MODE_REP up to LIVE_MAX
+#define LIVE_POLL()  if (LivePoll) { poll_step(); }
+#else
+#define LIVE_POLL()
+#endif
+
+/*
+ * Remote control (USE_UART), see uart_task().
+ */
+#if USE_TIME
+/*
+ * Time base and G.821 style seconds (USE_TIME).
+ * Timer1 (Fosc/4 /8 = 625kHz) is reset by CCP1 every 62500 counts,
+ * a 100ms tick; 10 ticks are one second, counted from the first lock.
+ *   ES  : errored second (at least one error)
+ *   SES : severely errored second (BER >= 1E-3, sync lost, no clock)
+ *   UAS : unavailable: starts with 10 SES in a row, ends with 10
+ *         non-SES in a row (those 10 are available time again).
+ * ES and SES only count available seconds.
+ * ENGINE_TMR0 counts the ticks in #int_ccp1. ENGINE_POLL runs with
+ * interrupts off and looks at CCP1IF once per byte, so below 80 bit/s
+ * (10 bytes per tick) ticks are lost there.
+ * With ENGINE_POLL this runs in one gap between two bits (rx_time()),
+ * so no call does much: the tick that ends a second only takes this
+ * second's errors and bytes (16 bits are enough, a second is at most
+ * 62500 bytes), and sec_step() does the rest over the next three bytes.
+ */
+#if BERT_ENGINE == ENGINE_TMR0
+int   TickDue;               // ticks from tick_isr() not handled yet
+#else
+#bit  CCP1IF = getenv("BIT:CCP1IF")
+#endif
+int   TickSub;               // ticks in the current second (MODE_NRZ: compares)
+short TimeOn;                // seconds are being counted (after lock)
+short Locked;                // count phase running
+short SecLos;                // this second had no sync (-> SES)
+long  SecErr0, SecByte0;     // ErrorBits / CountBytes (low 16) at the second start
+long  SecE, SecB;            // errors / bytes of the second being closed
+int   SecStep;               // sec_step() to run next, 0 = none
+short SecSes, SecEs;         // its verdict (sec_step() 1)
+int32 TotalSec;              // seconds since the first lock
+long  EsSec, SesSec, UaSec;  // ES, SES, unavailable seconds
+int   SesRun;                // SES in a row (available)
+int   OkRun;                 // non-SES in a row (unavailable)
+int   PendEs;                // ES among those OkRun seconds
+short Unavail;               // in unavailable time
+int32 TimeTarget;            // seconds to run, 0 = length in bits
+#endif
+
+#if USE_RATE
+/*
+ * CLK_IN rate (USE_RATE).
+ * TMR0 counts CLK_IN on RA4/T0CKI while Timer1 times a 100ms gate; the
+ * 8-bit TMR0 overflows are counted by polling T0IF, so the gate loop is
+ * good for far more than the engines can take. RATE_MAX is the rate the
+ * selected engine should sustain in the worst case; faster clocks are
+ * flagged with '!'.
+ * Only the #asm bit loops are counted instruction by instruction. The
+ * rest are estimates from the CCS code, not taken from a listing or
+ * measured, so each RATE_MAX leaves a third on top of the estimated
+ * cycles per bit (5MHz / (cycles * 4/3)):
+ *   ENGINE_TMR0 : about 80 cycles of interrupt per bit (the CCS save
+ *                 and restore alone about 45, clk_isr() the rest), and
+ *                 RxRing[] spreads a byte of rx_byte(), up to about
+ *                 420, over its 8 bits: 135.
+ *   USE_ASM     : 11 cycles per bit plus the longest step of the sync
+ *                 or count phase, 65 (70 with USE_HIST), see
+ *                 rx_bits_r(): 76 (81).
+ *   C loop      : about 65 cycles of C bit path, up to 20 to find the
+ *                 step for this bit (RxLeft) and the step itself, 55:
+ *                 140.
+ *   USE_PROF    : the same with the Timer1 reads (30 per bit) and no
+ *                 time base: about 170.
+ *   MODE_LANE   : the C bit path with the PORTB read, about 70, and
+ *                 all of rx_byte() and PN_FN(next)() after the 8th bit,
+ *                 about 430: 500.
+ * USE_PROF shows the spare cycles of the C loop on the line (prof_init());
+ * a run with its minimum near 0 is at the limit.
+ */
+#if BERT_ENGINE == ENGINE_TMR0
+#define RATE_MAX   27000     // estimate, see above
+#elif USE_ASM && USE_HIST
+#define RATE_MAX   46000     // estimate, longest gap, see rx_bits_r()
+#elif USE_ASM
+#define RATE_MAX   49000     // estimate, longest gap, see rx_bits_r()
+#elif USE_PROF
+#define RATE_MAX   22000     // estimate, C loop plus the Timer1 reads
+#else
+#define RATE_MAX   26000     // estimate, C loop
+#endif
+#define CAP_MAX    500000    // MODE_CAP, counted, see cap_fill()
+#define LANE_MAX   7000      // MODE_LANE, estimate, C loop with a PORTB read
+
+#bit  T0IF   = getenv("BIT:T0IF")
+#bit  TMR1IF = getenv("BIT:TMR1IF")
+
+int32 RunRate;               // CLK_IN rate at the start of the last run, Hz
+char  RateTxt[6];
+int   RatePos;               // wait_key() refreshes the rate here, 0 = off
+#endif
+
+#if USE_OVR
+/*
+ * Overrun check (USE_OVR).
+ *   ENGINE_POLL : TMR0 counts CLK_IN edges in hardware during the run;
+ *                 at every byte boundary it must have moved by exactly
+ *                 8 since the last one (OVR_CHECK() in pn_loop.c).
+ *   ENGINE_TMR0 : TMR0 is re-armed to 0xFF per edge, so it must read 0
+ *                 when clk_isr() runs; more means edges came in before
+ *                 the ISR got there. A full RxRing[] also counts.
+ */
+int   Overrun;               // overrun events in this run (saturates at 255)
+#if BERT_ENGINE == ENGINE_POLL
+int   TmrLast;               // TMR0 at the last byte boundary
+int   TmrNow;
+
+#define OVR_MARK()   TmrLast = get_timer0()
+#define OVR_CHECK()  TmrNow = get_timer0(); \
+                     if (TmrNow - TmrLast != 8) { ovr_hit(); } \
+                     TmrLast = TmrNow
+#endif
+#endif
+
+#if !USE_OVR || BERT_ENGINE != ENGINE_POLL
+#define OVR_MARK()
+#define OVR_CHECK()
+#endif
+
+#if USE_PROF
+/*
+ * Bit loop profile (USE_PROF).
+ * Timer1 runs free at Fosc/4, one count per instruction cycle (200ns).
+ * PROF_START() goes before the wait for the idle clock level and
+ * PROF_END() after the wait for the sampling edge, so each reading is
+ * the time spent spinning in both waits of one bit, plus the cost of
+ * the reads themselves (ProfZero, measured by prof_init()). The byte
+ * boundaries give the minimum: ProfMin - ProfZero near 0 means the
+ * loop is at its limit for this clock. Periods above 65535 cycles
+ * (clocks below 80 Hz) wrap.
+ */
+#define PROF_NONE    0xFFFF  // ProfMin before the first counted bit
+
+long  ProfT;                 // Timer1 at PROF_START()
+long  ProfD;                 // last reading
+long  ProfMin, ProfMax;      // readings of this run, ProfZero included
+long  ProfZero;
+
+#define PROF_START()  ProfT = get_timer1()
+#define PROF_END()    ProfD = get_timer1() - ProfT; \
+                      if (ProfD < ProfMin) { ProfMin = ProfD; } \
+                      if (ProfD > ProfMax) { ProfMax = ProfD; }
+
+/* --------------------------------------------------------
+ * prof_init()
+ * - countber(), after clk_rate(): Timer1 free running at 1:1, the
+ *   cost of an empty PROF_START() / PROF_END() pair in ProfZero.
+ * -------------------------------------------------------- */
+void prof_init() {
+    setup_timer_1(T1_INTERNAL | T1_DIV_BY_1);
+
+    ProfMin = PROF_NONE;
+    PROF_START();
+    PROF_END();
+    ProfZero = ProfD;
+
+    ProfMin = PROF_NONE;
+    ProfMax = 0;
+}
+
+/* --------------------------------------------------------
+ * prof_spare()
+ * - A reading in spare cycles (ProfZero taken off).
+ * -------------------------------------------------------- */
+long prof_spare(long d) {
+    if (d < ProfZero) { return 0; }
+    return d - ProfZero;
+}
+#else
+#define PROF_START()
+#define PROF_END()
+#endif
+
+#if USE_UART
+short StopReq;               // 'X': end the running measurement
+int   Remote;                // 'S'/'W': key code for main(), 0 = none
+int   UartCmd;               // command letter waiting for its digit
+#endif
+
+#if BERT_ENGINE == ENGINE_TMR0
+#priority rtcc               // sampling first, other interrupts after it
+#endif
+
+/* Speed optimization for PORTA I/O (CCS) */
+#use fast_io(a)
+
+#if USE_UART
+/* --------------------------------------------------------
+ * uart_stop()
+ * - Remote stop, checked by rx_wrap() every 256 bytes.
+ * - ENGINE_POLL measures with interrupts off: the USART is read
+ *   directly and anything but 'X' is dropped.
+ * -------------------------------------------------------- */
+short uart_stop() {
+#if BERT_ENGINE == ENGINE_POLL
+    if (kbhit()) {
+        if (getc() == 'X') { StopReq = TRUE; }
+    }
+#endif
+    return StopReq;
+}
+#else
+#define uart_stop()  FALSE
+#endif
+
+#if USE_TIME
+/* --------------------------------------------------------
+ * sec_step()
+ * - One part of closing a second, from TIME_POLL() when no tick is
+ *   due:
+ *     1 : ES / SES. SES: e / (8 * b) >= 1E-3  <=>  125 e >= b, with
+ *         125 e = 128 e - 4 e + e in 16 bits; any e >= 525 is
+ *         an SES already (b < 65536).
+ *     2 : the G.821 availability state
+ *     3 : the seconds count; reaching TimeTarget ends the block on
+ *         the next counted byte
+ * -------------------------------------------------------- */
+void sec_step() {
+    if (SecStep == 1) {
+        if (SecB == 0 || SecE >= 525)                          { SecSes = TRUE; }
+        else if ((SecE << 7) - (SecE << 2) + SecE >= SecB)     { SecSes = TRUE; }
+        SecEs   = SecSes || SecE != 0;
+        SecStep = 2;
+        return;
+    }
+
+    if (SecStep == 3) {
+        SecStep = 0;
+        TotalSec++;
+        if (TotalSec == TimeTarget) {
+            TotalBytes = CountBytes.w + 1;
+            TotalLo    = make8(TotalBytes, 0);
+        }
+        return;
+    }
+
+    SecStep = 3;
+    if (!Unavail) {
+        if (SecEs) { EsSec++; }
+        if (SecSes) {
+            SesSec++;
+            if (++SesRun == 10) {            // these 10 SES start unavailable time
+                Unavail = TRUE;
+                EsSec  -= 10;
+                SesSec -= 10;
+                UaSec  += 10;
+                OkRun   = 0;
+                PendEs  = 0;
+            }
+        } else {
+            SesRun = 0;
+        }
+    } else {
+        UaSec++;
+        if (SecSes) {
+            OkRun  = 0;
+            PendEs = 0;
+        } else {
+            if (SecEs) { PendEs++; }
+            if (++OkRun == 10) {             // available again since 10 seconds
+                Unavail = FALSE;
+                UaSec  -= 10;
+                EsSec  += PendEs;
+                SesRun  = 0;
+            }
+        }
+    }
+}
+
+/* --------------------------------------------------------
+ * sec_end()
+ * - The tick that closes a second: its errors and bytes (16-bit
+ *   differences of the low words) and whether it lost sync. The
+ *   decision is left to sec_step(), one part per byte.
+ * - A second still being decided (a clock below 80 bit/s) is finished
+ *   first.
+ * -------------------------------------------------------- */
+void sec_end() {
+    long n;
+
+    while (SecStep) { sec_step(); }
+
+    n = make16(ErrorBits.b[1], ErrorBits.b[0]);
+    SecE     = n - SecErr0;
+    SecErr0  = n;
+    n = make16(CountBytes.b[1], CountBytes.b[0]);
+    SecB     = n - SecByte0;
+    SecByte0 = n;
+
+    SecSes  = SecLos;
+    SecLos  = !Locked;
+    SecStep = 1;
+}
+
+/* --------------------------------------------------------
+ * tick()
+ * - One 100ms tick, from TIME_POLL(). MODE_NRZ calls it for every
+ *   CCP1 compare instead, 80 of them in a second (tick_ccp()).
+ * -------------------------------------------------------- */
+void tick() {
+    if (!TimeOn) { return; }
+#if USE_NRZ
+    if (++TickSub < ((Mode == MODE_NRZ) ? 80 : 10)) { return; }
+#else
+    if (++TickSub < 10) { return; }
+#endif
+    TickSub = 0;
+    sec_end();
+}
+
+#if BERT_ENGINE == ENGINE_TMR0
+#int_ccp1
+void tick_isr() {
+    TickDue++;
+}
+
+#define TIME_POLL()  if (TickDue) { TickDue--; tick(); } \
+                     else if (SecStep) { sec_step(); }
+#elif USE_NRZ
+/* --------------------------------------------------------
+ * tick_ccp()
+ * - CCP1IF of ENGINE_POLL. MODE_NRZ needs Timer1 free running for
+ *   nrz_bit(), so CCP1 only compares there: the next compare is set
+ *   NRZ_CCP later and tick() counts eight of them per 100ms.
+ * -------------------------------------------------------- */
+void tick_ccp() {
+    if (Mode == MODE_NRZ) { CCP_1 += NRZ_CCP; }
+    tick();
+}
+
+#define TIME_POLL()  if (CCP1IF) { CCP1IF = 0; tick_ccp(); } \
+                     else if (SecStep) { sec_step(); }
+#else
+#define TIME_POLL()  if (CCP1IF) { CCP1IF = 0; tick(); } \
+                     else if (SecStep) { sec_step(); }
+#endif
+
+/* --------------------------------------------------------
+ * time_init()
+ * - Before a run: no seconds yet, Timer1 runs as the 100ms tick.
+ * -------------------------------------------------------- */
+void time_init() {
+    TimeOn   = FALSE;
+    Locked   = FALSE;
+    SecStep  = 0;
+    TotalSec = 0;
+    EsSec    = 0;
+    SesSec   = 0;
+    UaSec    = 0;
+    SesRun   = 0;
+    Unavail  = FALSE;
+
+    TimeTarget = 0;
+    if (TBI >= TBI_BITS && Mode != MODE_CONT && Mode != MODE_REP) {
+        TimeTarget = (int32)tmin[TBI - TBI_BITS] * 60;
+    }
+
+    setup_timer_1(T1_INTERNAL | T1_DIV_BY_8);
+    CCP_1 = 62500 - 1;
+    setup_ccp1(CCP_COMPARE_RESET_TIMER);
+}
+#else
+#define TIME_POLL()
+#endif
+
+/*
+ * Count phase core: rx_byte(), relock(), fmt_ber() and the histogram
+ * (portable, also built by host/).
+ */
+#include "bert_core.c"
+
+/* --------------------------------------------------------
+ * on_lock()
+ * - pnX_count(): sync phase done, the count phase starts.
+ * - USE_TIME: the first lock of a run starts the seconds.
+ * -------------------------------------------------------- */
+void on_lock() {
+    output_high(SYNC_LED);
+
+#if USE_TIME
+    Locked = TRUE;
+    if (!TimeOn) {
+#if USE_NRZ
+        if (Mode == MODE_NRZ) {
+            CCP_1  = get_timer1() + NRZ_CCP;     // Timer1 is the bit clock
+        } else
+#endif
+        set_timer1(0);
+#if BERT_ENGINE == ENGINE_TMR0
+        TickDue = 0;
+#else
+        CCP1IF  = 0;
+#endif
+        TickSub  = 0;
+        SecLos   = FALSE;
+        SecErr0  = make16(ErrorBits.b[1], ErrorBits.b[0]);
+        SecByte0 = make16(CountBytes.b[1], CountBytes.b[0]);
+        TimeOn   = TRUE;
+    }
+#endif
+}
+
+#if USE_UART
+/*
+ * Serial protocol (USE_UART), one ASCII command per letter:
+ *   S      start a measurement (as SW_SEL on the main screen)
+ *   X      stop the running measurement
+ *   Ln     length TBI = n (hex digit): 0..7 = 1E(n+3) bits, 8..B minutes
+ *   Pn     polynomial index n = 0..5 (POLY_xxx, 5 = word; <PN> = 0)
+ *   Mn     mode n = 0..7 (MODE_xxx)
+ *   In     error injection n = 0..4 (off, 1E-3..1E-6; USE_INJ)
+ *   En     BER limit n = 0..7 (off, 1E-3..1E-9; USE_EARLY)
+ *   Bn     MODE_NRZ rate n = 0..3 (1200..9600 bit/s; USE_NRZ)
+ *   W      save settings to EEPROM (as both keys)
+ *   ?      settings record, or counter record while measuring
+ *   H      histogram record of the last run (USE_HIST)
+ * Records, CSV lines ending in CR LF (counters in hex, no division):
+ *   S,<PN>,<TBI>,<mode>,<DataNeg>,<ClockNeg>,<ThresError>[,<InjSel>]
+ *     [,<EarlySel>][,<NrzSel>]
+ *   C,<ErrorBits>,<CountBytes>,<SyncLoss>
+ *   R,<PN>,<ErrorBits>,<CountBytes>,<SyncLoss>,<BER>[,<Hz>][,<overruns>]
+ *     [,P|F|O]                       (end of run; USE_RATE, USE_OVR,
+ *                                     USE_EARLY with a limit set)
+ *   H,<BURST_BINS burst bins>,<GAP_BINS gap bins>      (4 hex digits each)
+ *   T,<seconds>,<ES>,<SES>,<UAS>                       (after R, USE_TIME)
+ *   N,<LaneErr[0]>,..,<LaneErr[3]>       (after R, MODE_LANE, USE_LANE)
+ * Bits = 8 * CountBytes.
+ */
+#define UART_C_LEN  24       // length of a C record
+
+void uart_settings() {
+    printf(ser_putc, "S,%u,%u,%u,%u,%u,%u", pn_deg[Poly], TBI,
+           Mode, DataNeg, ClockNeg, ThresError);
+#if USE_INJ
+    printf(ser_putc, ",%u", InjSel);
+#endif
+#if USE_EARLY
+    printf(ser_putc, ",%u", EarlySel);
+#endif
+#if USE_NRZ
+    printf(ser_putc, ",%u", NrzSel);
+#endif
+    printf(ser_putc, "\r\n");
+}
+
+/* --------------------------------------------------------
+ * uart_set()
+ * - Ln / Pn / Mn / In / En / Bn; out-of-range values are ignored. The settings
+ *   record is the reply either way.
+ * -------------------------------------------------------- */
+void uart_set(int cmd, int v) {
+    switch (cmd) {
+        case 'L':
+            if (v < TBI_COUNT) { TBI = v; }
+            break;
+
+        case 'P':
+            if (v < POLY_COUNT && pn_on[v]) { Poly = v; }
+            break;
+
+        case 'M':
+            if (v < MODE_COUNT && mode_on[v]) { Mode = v; }
+            break;
+
+#if USE_INJ
+        case 'I':
+            if (v < INJ_COUNT) { InjSel = v; }
+            break;
+#endif
+
+#if USE_EARLY
+        case 'E':
+            if (v < EARLY_COUNT) { EarlySel = v; }
+            break;
+#endif
+
+#if USE_NRZ
+        case 'B':
+            if (v < NRZ_COUNT) { NrzSel = v; }
+            break;
+#endif
+    }
+    uart_settings();
+    Remote = 4;                              // no key: main screen redraw
+}
+
+#if USE_HIST
+void uart_hist() {
+    int i;
+
+    printf(ser_putc, "H");
+    for (i = 0; i < BURST_BINS; i++) { printf(ser_putc, ",%04LX", BurstHist[i]); }
+    for (i = 0; i < GAP_BINS; i++)   { printf(ser_putc, ",%04LX", GapHist[i]); }
+    printf(ser_putc, "\r\n");
+}
+#endif
+
+/* --------------------------------------------------------
+ * uart_task()
+ * - Handles at most one received character per call.
+ * - run: called from the measurement's idle loop (ENGINE_TMR0). Only
+ *   X and ? are taken then, and a C record is only sent when it fits
+ *   into the TX ring, so nothing here ever waits.
+ * -------------------------------------------------------- */
+void uart_task(short run) {
+    int c;
+
+    if (!ser_kbhit()) { return; }
+    c = ser_getc();
+
+    if (UartCmd) {                           // digit of Ln / Pn / Mn / In / En / Bn
+        if (c >= 'A') { c -= 'A' - 10; }
+        else          { c -= '0'; }
+        if (!run) { uart_set(UartCmd, c); }
+        UartCmd = 0;
+        return;
+    }
+
+    switch (c) {
+        case 'L':
+        case 'P':
+        case 'M':
+#if USE_INJ
+        case 'I':
+#endif
+#if USE_EARLY
+        case 'E':
+#endif
+#if USE_NRZ
+        case 'B':
+#endif
+            UartCmd = c;
+            break;
+
+        case 'S':
+            if (!run) { Remote = 1; }
+            break;
+
+        case 'W':
+            if (!run) { Remote = 3; }
+            break;
+
+        case 'X':
+            if (run) { StopReq = TRUE; }
+            break;
+
+#if USE_HIST
+        case 'H':
+            if (!run) { uart_hist(); }
+            break;
+#endif
+
+        case '?':
+            if (!run) {
+                uart_settings();
+            } else if (ser_room() >= UART_C_LEN) {
+                printf(ser_putc, "C,%08LX,%08LX,%u\r\n",
+                       ErrorBits.w, CountBytes.w, SyncLoss);
+            }
+            break;
+    }
+}
+#endif
+
+#if USE_OVR
+/* ovr_hit(): one overrun event */
+void ovr_hit() {
+    if (Overrun != 0xFF) { Overrun++; }
+}
+#endif
+
+#if BERT_ENGINE == ENGINE_TMR0 || USE_OVR
+/* --------------------------------------------------------
+ * clk_edge()
+ * - TMR0 counts the logical rising edge: T0SE from ClockNeg.
+ * -------------------------------------------------------- */
+void clk_edge() {
+    if (ClockNeg) { setup_timer_0(RTCC_EXT_H_TO_L | RTCC_DIV_1); }
+    else          { setup_timer_0(RTCC_EXT_L_TO_H | RTCC_DIV_1); }
+}
+#endif
+
+#if BERT_ENGINE == ENGINE_TMR0
+/*
+ * Interrupt-driven capture.
+ * clk_isr() only packs bits into bytes; the polynomial engine takes them
+ * from RxRing[] with rx_get(). The ring gives the main loop RX_RING*8
+ * clocks of slack.
+ */
+#define RX_RING   8          // power of 2
+#define RX_MASK   (RX_RING - 1)
+
+int  RxRing[RX_RING];
+int  RxHead;                 // written by clk_isr()
+int  RxTail;                 // written by rx_get()
+
+/* --------------------------------------------------------
+ * clk_isr()
+ * - TMR0 overflow = one (logical) rising edge on CLK_IN.
+ * - Shifts the bit into RxByte and queues every 8th bit.
+ * - NOCLEAR: T0IF is cleared here *before* TMR0 is re-armed,
+ *   so an edge arriving during the handler is not thrown away.
+ * - USE_OVR: TMR0 != 0 here means more edges than this one came in;
+ *   a byte that finds RxRing[] full is dropped. Both are overruns.
+ * -------------------------------------------------------- */
+#int_rtcc NOCLEAR
+void clk_isr() {
+    short d;
+#if USE_OVR
+    int t, n;
+#endif
+
+    d = input(DATA_IN);             // sample first: closest to the edge
+#if USE_OVR
+    t = get_timer0();
+#endif
+
+    clear_interrupt(INT_RTCC);
+    set_timer0(0xFF);               // re-arm: next edge overflows again
+
+#if USE_OVR
+    if (t) { ovr_hit(); }
+#endif
+
+    shift_left(&RxByte, 1, d);
+    if (--RxLeft == 0) {
+        RxLeft = 8;
+#if USE_OVR
+        n = (RxHead + 1) & RX_MASK;
+        if (n == RxTail) {
+            ovr_hit();
+        } else {
+            RxRing[RxHead] = RxByte;
+            RxHead = n;
+        }
+#else
+        RxRing[RxHead] = RxByte;
+        RxHead = (RxHead + 1) & RX_MASK;
+#endif
+    }
+}
+#endif
+
+/*
+ * Live screens (live_init(), rep_step(), cont_step()): portable, the
+ * host build checks them.
+ */
+#include "live.c"
+
+#if BERT_ENGINE == ENGINE_TMR0
+/* --------------------------------------------------------
+ * live_digit()
+ * - One decimal digit of LiveNum into LcdFb[pos], right to left.
+ *   Leading zeros become blanks (the units digit is always shown).
+ * -------------------------------------------------------- */
+void live_digit(int pos, short units) {
+    int32 q;
+
+    if (LiveNum == 0 && !units) {
+        fb_put(pos, ' ');
+        return;
+    }
+    q = LiveNum / 10;
+    fb_put(pos, '0' + (int)(LiveNum - q * 10));
+    LiveNum = q;
+}
+#endif
+
+#if POLL_LIVE
+/* --------------------------------------------------------
+ * poll_step()
+ * - LIVE_POLL() of the ENGINE_POLL count loop, once per byte in the
+ *   gap after the 5th bit, while LivePoll (MODE_CONT / MODE_REP with a
+ *   clock of at most LIVE_MAX): one LCD character, or else one
+ *   cont_step() / rep_step().
+ * - Its longest path (cycles, estimated from the CCS code, not
+ *   measured):
+ *       fb_task(): scan, skipping clean groups of 8   about 300
+ *                  lcd_gotoxy() + lcd_putc()          about 200
+ *       cont_step(): div10(), a mantissa digit, or
+ *                    ber_txt() and 8 fb_put()         about 300
+ *       rep_step(): live_dec(), rep_ber()             about 300
+ *   so about 500 cycles (100us). USE_UART's lcd_u.c ends every LCD
+ *   byte with a fixed delay_us(50): lcd_gotoxy() + lcd_putc() take
+ *   about 600 cycles there, about 900 in all. One bit of LIVE_MAX
+ *   (4800) is 1040 cycles: twice the estimate with lcd_b.c, and still
+ *   above it with lcd_u.c. Only USE_OVR would show a missed edge, so
+ *   the limit stays there until USE_PROF or a listing confirms more.
+ * - USE_EARLY: rx_early() comes next in the same gap, so a byte with a
+ *   queued error bit (MODE_CONT only, MODE_REP has no early end) has
+ *   no step here: both would not fit the bit.
+ * -------------------------------------------------------- */
+void poll_step() {
+#if USE_EARLY
+    if (EarlyPend) { return; }
+#endif
+    if (fb_task()) { return; }
+#if USE_REP
+    if (Mode == MODE_REP) {
+        rep_step();
+        return;
+    }
+#endif
+    cont_step();
+}
+#endif
+
+#if BERT_ENGINE == ENGINE_TMR0
+
+/* --------------------------------------------------------
+ * live_step()
+ * - One small piece of the live screen update:
+ *     1.23E-05 12345kb      running BER, bits counted
+ *     E=        12          error bits
+ *     step  0     : fmt_ber() of the counters -> LcdFb[0..7]
+ *     step  1..10 : error count digits        -> LcdFb[27..18]
+ *     step 11     : take the bit count, in kbit, or in Mbit from
+ *                   100000 kbit on (5 digits up to 2^32 bytes)
+ *     step 12..16 : bit count digits          -> LcdFb[13..9]
+ * - Counters are read while no rx_byte() can run (same main loop),
+ *   so the BER and the error count are of the same byte.
+ * -------------------------------------------------------- */
+void live_step() {
+    int i;
+
+#if USE_REP
+    if (Mode == MODE_REP) {
+        rep_step();
+        return;
+    }
+#endif
+
+    if (LiveStep == 0) {
+        if (!LiveDue || Mode != MODE_CONT) { return; }
+        LiveDue = FALSE;
+        fmt_ber(ErrorBits.w, CountBytes.w);
+        i = 0;
+        while (BerTxt[i]) { fb_put(i, BerTxt[i]); i++; }
+        while (i < 8)     { fb_put(i++, ' '); }
+        LiveNum = ErrorBits.w;
+        LiveStep = 1;
+        return;
+    }
+
+    if (LiveStep <= 10) {
+        live_digit(28 - LiveStep, LiveStep == 1);
+    } else if (LiveStep == 11) {
+        LiveNum = CountBytes.w / 125;        // bytes -> kbit
+        fb_put(14, 'k');
+        if (LiveNum >= 100000) {
+            LiveNum /= 1000;
+            fb_put(14, 'M');
+        }
+    } else {
+        live_digit(25 - LiveStep, LiveStep == 12);
+    }
+
+    if (++LiveStep == 17) { LiveStep = 0; }
+}
+
+/* --------------------------------------------------------
+ * rx_get()
+ * - Next received byte from clk_isr() (waits for it).
+ * - The wait is the main loop's idle time: the LCD is updated here,
+ *   pending characters first, then the next live_step(), and remote
+ *   commands (USE_UART).
+ * -------------------------------------------------------- */
+int rx_get() {
+    int r;
+
+    while (RxTail == RxHead) {
+        TIME_POLL();                         // seconds go on without a clock
+        if (!fb_task()) {
+            live_step();
+#if USE_UART
+            uart_task(TRUE);
+#endif
+        }
+    }
+
+    r = RxRing[RxTail];
+    RxTail = (RxTail + 1) & RX_MASK;
+    return r;
+}
+#endif
+
+#if AUTO_POL
+/* --------------------------------------------------------
+ * clock_flip()
+ * - Called by pnX_sync() when nothing locked on this clock edge.
+ *   ENGINE_POLL reads ClockNeg in its edge waits; ENGINE_TMR0 needs
+ *   T0SE changed (a spurious count only costs one sync byte).
+ * - USE_OVR: ENGINE_POLL's TMR0 must count the new edge as well, or
+ *   cap_fill() and the first OVR_CHECK() after the lock read one edge
+ *   short whenever the clock starts on the other level.
+ * -------------------------------------------------------- */
+void clock_flip() {
+#if USE_NRZ
+    if (Mode == MODE_NRZ) { return; }        // no clock to flip
+#endif
+    ClockNeg = !ClockNeg;
+#if BERT_ENGINE == ENGINE_TMR0 || USE_OVR
+    clk_edge();
+#endif
+}
+#endif
+
+#if BERT_ENGINE == ENGINE_POLL && (USE_ASM || USE_CAP)
+/*
+ * #asm sampling loops (ENGINE_POLL: USE_ASM, USE_CAP).
+ * CLK_IN = RA4, DATA_IN = RA5 are hard-wired into the code below.
+ */
+#byte PORTA  = getenv("SFR:PORTA")
+#byte STATUS = getenv("SFR:STATUS")
+#endif
+
+#if BERT_ENGINE == ENGINE_POLL && USE_ASM
+
+/* --------------------------------------------------------
+ * rx_bits_r() / rx_bits_f()
+ * - n (1..8) more bits into RxByte, sampled on the rising / falling
+ *   CLK_IN edge; the polarity is in the code, not an XOR per bit.
+ * - Each bit: wait for the idle level, wait for the edge, DATA_IN into
+ *   Carry, rotate into RxByte. Cycles per bit when the edge is already
+ *   there (Tcy = 200ns @20MHz):
+ *       wait idle  2   btfsc (skip)
+ *       wait edge  2   btfss (skip)
+ *       sample     3   bcf C / btfsc DATA / bsf C
+ *       store      1   rlf RxByte
+ *       count      3   decfsz n / goto
+ *       ---------------
+ *                 11   = 2.2us
+ *   A wait loop polls every 3 cycles, so DATA_IN is read 3..5 cycles
+ *   (0.6..1.0us) after the edge and each clock level must last at
+ *   least 3 cycles.
+ * - Bit path alone: the 11 cycles above, a clock of about 450kHz. A
+ *   gap of G cycles of byte work after a bit needs a clock period of
+ *   G + 11 cycles. The count loop of pn_loop.c calls these one bit at
+ *   a time and does one step of the byte work in every gap (see
+ *   rx_cmp() in bert_core.c). Worst case per gap with the default
+ *   options (cycles, estimated from the CCS code, including about 10
+ *   for the return, the call and the next rx_bits_r(1); a clean byte
+ *   in brackets):
+ *       1  PN_FN(next)(), INJ_BYTE()                     50  (50)
+ *       2  rx_err(): nbits[], ErrorBits, early_err()     60  (15)
+ *       3  rx_los(): LOS window                          30  (15)
+ *       4  rx_wrap(): every 256 bytes CARRY32, stop
+ *          key, PASS test; rep_next()                    60  (15)
+ *       5  rx_early(): one early_step()                  60  (15)
+ *       6  rx_time(): tick() and sec_end(), or one
+ *          sec_step()                                    65  (15)
+ *       7  rx_end(): 32-bit end test, rep_block()        60  (15)
+ *       8  OVR_CHECK(), rx_cmp(), the loop               35  (35)
+ *   USE_HIST adds about 40 to gap 3 (hist_gap() / hist_burst() on the
+ *   first byte after a gap or a burst). LIVE_POLL() (gap 5) only runs
+ *   below LIVE_MAX, see poll_step().
+ * - The sync phase (PN_FN(lock)()) uses the same loops, with the steps
+ *   of PN_FN(sync)() in the gaps (a LOAD byte in brackets):
+ *       1  sync_alt(): first VERIFY byte, the seed
+ *          into PnSeed, next() on the inverted one       65  (15)
+ *       2  sync_swap(): the same byte, XOR swap          35  (15)
+ *       3  sync_exp(): PN_FN(next)()                     50  (15)
+ *       6  TIME_POLL(): tick() and sec_end()             65  (15)
+ *       8  OVR_MARK(), sync_cmp(): compare, PnSeed
+ *          on a polarity flip; on_lock() after it        60  (35)
+ *   No gap of the sync phase is longer than the count phase's.
+ * - Only the 11 cycles of the bit path are counted; the gaps are
+ *   estimates. They give 5MHz / (65 + 11) cycles, about 65kHz, for any
+ *   error pattern (USE_HIST: 5MHz / 81, 60kHz) and 5MHz / (50 + 11),
+ *   about 80kHz, for a clean line. RATE_MAX keeps a third of margin on
+ *   that: 49kHz (USE_HIST 46kHz). USE_OVR catches the clock edges
+ *   missed above the real limit.
+ * -------------------------------------------------------- */
+void rx_bits_r(int n) {
+#asm
+BIT_R:
+    btfsc  PORTA, 4          ; wait CLK low
+    goto   BIT_R
+EDGE_R:
+    btfss  PORTA, 4          ; wait CLK high = sampling edge
+    goto   EDGE_R
+    bcf    STATUS, 0         ; C = DATA_IN
+    btfsc  PORTA, 5
+    bsf    STATUS, 0
+    rlf    RxByte, F
+    decfsz n, F
+    goto   BIT_R
+#endasm
+}
+
+void rx_bits_f(int n) {
+#asm
+BIT_F:
+    btfss  PORTA, 4          ; wait CLK high
+    goto   BIT_F
+EDGE_F:
+    btfsc  PORTA, 4          ; wait CLK low = sampling edge
+    goto   EDGE_F
+    bcf    STATUS, 0         ; C = DATA_IN
+    btfsc  PORTA, 5
+    bsf    STATUS, 0
+    rlf    RxByte, F
+    decfsz n, F
+    goto   BIT_F
+#endasm
+}
+#endif
+
+#if USE_CAP
+#byte FSR    = getenv("SFR:FSR")
+#byte INDF   = getenv("SFR:INDF")
+#bit  IRP    = STATUS.7
+
+/* --------------------------------------------------------
+ * cap_fill()
+ * - One burst: CAP_LEN * 8 bits of DATA_IN into CapBuf[] on the
+ *   ClockNeg edge, nothing else between the edges.
+ * - Straight-line #asm per byte; a bit is two edge polls and a
+ *   btfsc/bsf into the byte at INDF (CapBuf[] is cleared first):
+ *       wait idle  2   wait edge  2   sample  2   = 6 cycles
+ *   plus 4 cycles (incf FSR / decfsz / goto) after every 8th bit.
+ *   Clock period >= 10 cycles = 2us: CAP_MAX 500kHz @20MHz, each
+ *   clock level at least 3 cycles.
+ * - TIME_POLL() is not called in a burst; CCP1IF keeps one tick.
+ * - USE_OVR: TMR0 must have seen exactly CAP_LEN * 8 edges.
+ * -------------------------------------------------------- */
+void cap_fill() {
+    int n;
+#if USE_OVR
+    int t;
+#endif
+
+    for (n = 0; n < CAP_LEN; n++) { CapBuf[n] = 0; }
+    FSR = make8((long)CapBuf, 0);
+    IRP = bit_test((long)CapBuf, 8);
+    n = CAP_LEN;
+#if USE_OVR
+    t = get_timer0();
+#endif
+
+    if (ClockNeg) {
+#asm
+CAP_F:
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 7
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 6
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 5
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 4
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 3
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 2
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 0
+    incf   FSR, F
+    decfsz n, F
+    goto   CAP_F
+#endasm
+    } else {
+#asm
+CAP_R:
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 7
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 6
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 5
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 4
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 3
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 2
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 1
+    btfsc  PORTA, 4
+    goto   $-1
+    btfss  PORTA, 4
+    goto   $-1
+    btfsc  PORTA, 5
+    bsf    INDF, 0
+    incf   FSR, F
+    decfsz n, F
+    goto   CAP_R
+#endasm
+    }
+
+#if USE_OVR
+    if ((int)(get_timer0() - t) != (int)(CAP_LEN * 8)) { ovr_hit(); }
+#endif
+}
+
+/* --------------------------------------------------------
+ * cap_next()
+ * - pnX_cap(): between two bursts. The line was not watched in the
+ *   gap, so the next burst syncs again and no burst, gap or slip
+ *   window reaches across.
+ * -------------------------------------------------------- */
+void cap_next() {
+    output_low(SYNC_LED);
+    los_reset();
+#if USE_HIST
+    if (BurstBits) { hist_burst(); }
+    hist_sync(FALSE);
+#endif
+    SyncLoad     = 0;
+    RenzokuError = 0;
+}
+#endif
+
+#if USE_GEN
 /*
- * LCD driver:
- * This project uses CCS's LCD driver variant for PORTB.
- * Original comment: lcd.c #define use_portb_lcd TRUE  Un-comment ́B
+ * Generator bit clock (pnX_gen()): GEN_EDGE() is the sampling edge,
+ * GEN_IDLE() the way back. GEN_DATA changes before GEN_EDGE().
  */
-#include <lcd_b.c>
+#ifdef GEN_CLK
+#define GEN_EDGE()  output_high(GEN_CLK)
+#define GEN_IDLE()  output_low(GEN_CLK)
+#else
+#define GEN_EDGE()  while ( (!input(CLK_IN)) ^ ClockNeg )
+#define GEN_IDLE()  while ( (input(CLK_IN)) ^ ClockNeg )
+#endif
+#endif
 
-/* -----------------------------
- * Pin assignment (PIC16F648A)
- * -----------------------------
- * Inputs:
- *  - CLK_IN   : external clock input for bit sampling
- *  - DATA_IN  : external data input
- *  - SW_SEL   : "select / setting" button
- *  - SW_TRIG  : "trigger / start" button
- *
- * Outputs:
- *  - SYNC_LED : indicates lock/sync status (or general status LED)
- *
- * NOTE:
- * - Clock polarity and Data polarity can be inverted by flags ClockNeg/DataNeg
- *   (used as XOR masks when sampling).
+#if USE_LANE
+/*
+ * Lanes (pnX_lane()): PORTB is read directly, input_b() would turn
+ * RB0..RB3 into inputs as well.
  */
-#define CLK_IN    PIN_A4
-#define DATA_IN   PIN_A5
-#define SW_SEL    PIN_A0
-#define SW_TRIG   PIN_A1
-#define SYNC_LED  PIN_A3
+#byte PORTB = getenv("SFR:PORTB")
+#byte TRISB = getenv("SFR:TRISB")
 
-/* -----------------------------------------
- * EEPROM default contents (PIC data EEPROM)
- * -----------------------------------------
- * CCS: #ROM 0x2100 = {...} sets the initial EEPROM values.
- *
- * Address map (read/write):
- *   0: ClockNeg   (0/1) clock polarity invert flag
- *   1: DataNeg    (0/1) data polarity invert flag
- *   2: TBI        (0..5) index for TotalBits (measurement length)
- *   3: ThresError (int) threshold for sync phase (consecutive "match" count)
- *
- * Note: comment says 16F8X/16F87X/16F62X uses EEPROM from 0x2100.
+/* --------------------------------------------------------
+ * lane_err()
+ * - e: the lanes (LANE_PINS bits) that were wrong on this clock.
+ *   Only called for an error, a clean clock costs nothing here.
+ * -------------------------------------------------------- */
+void lane_err(int e) {
+    if (bit_test(e, 4)) { LaneErr[0]++; }
+    if (bit_test(e, 5)) { LaneErr[1]++; }
+    if (bit_test(e, 6)) { LaneErr[2]++; }
+    if (bit_test(e, 7)) { LaneErr[3]++; }
+}
+#endif
+
+#if USE_NRZ
+/* --------------------------------------------------------
+ * nrz_init()
+ * - countber(), after clk_rate() / time_init(): Timer1 free running
+ *   at 1:1 for the sample schedule of NrzSel; USE_TIME moves CCP1 to
+ *   plain compares (tick_ccp(), on_lock()).
+ * -------------------------------------------------------- */
+void nrz_init() {
+    setup_timer_1(T1_INTERNAL | T1_DIV_BY_1);
+#if USE_TIME
+    setup_ccp1(CCP_COMPARE_INT);
+    CCP1IF = 0;
+#endif
+    NrzTick = nrz_tick[NrzSel];
+    NrzPh   = 0;
+    NrzLast = input(DATA_IN);
+    NrzNext = get_timer1();
+}
+
+/* --------------------------------------------------------
+ * nrz_bit()
+ * - MODE_NRZ: the next bit recovered from DATA_IN, with interrupts
+ *   off like the clocked loops. DATA_IN is sampled every NrzTick
+ *   cycles and nrz_sample() keeps the bit phase; runs of 23 equal bits
+ *   (PN23) need the line within 1% of the nominal rate.
+ * - The schedule is absolute: after the byte work of the caller the
+ *   samples are late and catch up, none is lost. A late sample (no
+ *   wait at all) does not realign the phase.
+ * -------------------------------------------------------- */
+short nrz_bit() {
+    short late;
+    int b;
+
+    do {
+        NrzNext += NrzTick;
+        late = TRUE;
+        while ((signed long)(get_timer1() - NrzNext) < 0) { late = FALSE; }
+
+        b = nrz_sample(input(DATA_IN), late);
+    } while (b == NRZ_NONE);
+    return b;
+}
+#endif
+
+/*
+ * Polynomial engines: pnX_next(), pnX_count()
  */
-#ROM 0x2100 = {0,0,2,10}
+#define PN_N      9
+#define PN_K      5
+#define PN_FN(f)  pn9_##f
+#include "pn_loop.c"
 
-/* -----------------------------
- * Globals
- * ----------------------------- */
-short ClockNeg, DataNeg;     // XOR polarity flags (0/1)
-int   RenzokuError;          // "consecutive match counter" during sync (JP: A)
-int   ThresError;            // required consecutive matches to declare lock
-long  ErrorBits;             // number of bit errors during counting phase
-long  TotalBits;             // total bits to count during measurement (from table)
-long  CountBits;             // actual counted bits
+#if USE_PN7
+#define PN_N      7
+#define PN_K      6
+#define PN_FN(f)  pn7_##f
+#include "pn_loop.c"
+#endif
+
+#if USE_PN11
+#define PN_N      11
+#define PN_K      9
+#define PN_FN(f)  pn11_##f
+#include "pn_loop.c"
+#endif
+
+#if USE_PN15
+#define PN_N      15
+#define PN_K      14
+#define PN_FN(f)  pn15_##f
+#include "pn_loop.c"
+#endif
+
+#if USE_PN23
+#define PN_N      23
+#define PN_K      18
+#define PN_FN(f)  pn23_##f
+#include "pn_loop.c"
+#endif
+
+#if USE_WORD
+#define PN_WORD
+#define PN_FN(f)  word_##f
+#include "pn_loop.c"
+#endif
+
+#if USE_RATE
+/* --------------------------------------------------------
+ * clk_rate()
+ * - CLK_IN edges in 100ms, in Hz (10 Hz resolution). Blocks 100ms.
+ * - Leaves TMR0/Timer1 set up for the gate; countber() and
+ *   time_init() set them up again for a run.
+ * -------------------------------------------------------- */
+int32 clk_rate() {
+    long ovf;
+    int t;
+
+#if USE_TIME
+    setup_ccp1(CCP_OFF);                     // no special event reset in the gate
+#endif
+    setup_timer_0(RTCC_EXT_L_TO_H | RTCC_DIV_1);
+    setup_timer_1(T1_INTERNAL | T1_DIV_BY_8);
+
+    ovf = 0;
+    set_timer1(65536 - 62500);               // 62500 * 1.6us = 100ms
+    set_timer0(0);
+    T0IF   = 0;
+    TMR1IF = 0;
+    while (!TMR1IF) {
+        if (T0IF) { T0IF = 0; ovf++; }
+    }
+
+    t = get_timer0();
+    if (T0IF && t < 128) { ovf++; }          // overflow just after the loop
+    return make32(ovf, t) * 10;
+}
+
+/* --------------------------------------------------------
+ * fmt_rate()
+ * - hz into RateTxt, always 5 characters: "9.99k", " 999k",
+ *   "9.99M", "20.0M", or "noclk".
+ * -------------------------------------------------------- */
+void fmt_rate(int32 hz) {
+    long k;
+
+    if (hz == 0) {
+        strcpy(RateTxt, "noclk");
+    } else if (hz < 10000) {
+        k = hz / 10;
+        sprintf(RateTxt, "%u.%02uk", (int)(k / 100), (int)(k % 100));
+    } else if (hz < 1000000) {
+        sprintf(RateTxt, "%4Luk", hz / 1000);
+    } else if (hz < 10000000) {
+        k = hz / 10000;
+        sprintf(RateTxt, "%u.%02uM", (int)(k / 100), (int)(k % 100));
+    } else {
+        k = hz / 100000;
+        sprintf(RateTxt, "%2Lu.%uM", k / 10, (int)(k % 10));
+    }
+}
+
+/* --------------------------------------------------------
+ * put_rate()
+ * - Rate at LcdFb[pos..pos+4], '!' at pos-1 when above RATE_MAX
+ *   (CAP_MAX in MODE_CAP, LANE_MAX in MODE_LANE).
+ * -------------------------------------------------------- */
+void put_rate(int pos, int32 hz) {
+    int i;
+
+    fmt_rate(hz);
+#if USE_CAP
+    if (Mode == MODE_CAP) {
+        if (hz > CAP_MAX) { fb_put(pos - 1, '!'); }
+        else              { fb_put(pos - 1, ' '); }
+    } else
+#endif
+#if USE_LANE
+    if (Mode == MODE_LANE) {
+        if (hz > LANE_MAX) { fb_put(pos - 1, '!'); }
+        else               { fb_put(pos - 1, ' '); }
+    } else
+#endif
+    if (hz > RATE_MAX) { fb_put(pos - 1, '!'); }
+    else               { fb_put(pos - 1, ' '); }
+    for (i = 0; i < 5; i++) { fb_put(pos + i, RateTxt[i]); }
+}
+#endif
 
+#if USE_SLEEP
 /*
- * LFSR state buffer.
- * CCS provides shift_right(array, bytes, input_bit).
- * Here tap[] is used as a bit-array-like storage (short per element).
- *
- * The current feedback implementation uses tap[7] ^ tap[11].
- * If you want PN sequence other than the current one,
- * change the feedback taps accordingly.
+ * Wake-up keys (idle_sleep()): RA0 / RA1 have no interrupt-on-change,
+ * but they are comparator inputs. CM = 010 with CIS = 0 compares both
+ * with the internal reference (VREF_LOW | 12 = VDD / 2), and the
+ * comparator change interrupt wakes the PIC from SLEEP. An output is
+ * 1 while its key is up (pin below the reference).
  */
-short tap[16] = {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1};
+#byte CMCON  = getenv("SFR:CMCON")
+#bit  CMIF   = getenv("BIT:CMIF")
+#bit  CMIE   = getenv("BIT:CMIE")
+#bit  PEIE   = getenv("BIT:PEIE")
+
+/* --------------------------------------------------------
+ * idle_sleep()
+ * - SLEEP until a key goes down. GIE is off (no USE_UART), so the
+ *   PIC just goes on after SLEEP, no interrupt routine runs.
+ * - Idle current: the two comparators and the reference instead of
+ *   the 20MHz core. A key pressed between the last input() test and
+ *   SLEEP has already set CMIF, so SLEEP returns at once.
+ * -------------------------------------------------------- */
+void idle_sleep() {
+    int c;
+
+    setup_vref(VREF_LOW | 12);
+    setup_comparator(A0_VR_A1_VR);
+    delay_us(10);                            // comparator settling time
+
+    c = CMCON;                               // end the mismatch, then clear
+    CMIF = 0;
+    CMIE = 1;
+    PEIE = 1;
+    if ((c & 0xC0) == 0xC0) { sleep(); }     // C1OUT / C2OUT: 1 = key up
+    delay_cycles(1);                         // executed after the wake-up
+
+    CMIE = 0;
+    CMIF = 0;
+    setup_comparator(NC_NC_NC_NC);           // RA0..RA3 digital again
+    setup_vref(FALSE);
+}
+#endif
+
+/* --------------------------------------------------------
+ * wait_release() / wait_key()
+ * - Key waits of the UI, with debounce. The LCD is updated from the
+ *   frame buffer while waiting.
+ * - USE_UART: wait_key() also returns on a remote key (Remote != 0).
+ * - USE_RATE: with RatePos set, wait_key() measures the clock rate
+ *   again whenever the LCD is up to date.
+ * - USE_SLEEP: with the LCD up to date, wait_key() polls every 10ms
+ *   and goes to idle_sleep() after SLEEP_SEC (the rate gate counts
+ *   as 100ms).
+ * -------------------------------------------------------- */
+void wait_release() {
+    while ( input(SW_SEL) || input(SW_TRIG) ) { fb_task(); }
+    delay_ms(50);
+}
+
+void wait_key() {
+#if USE_UART
+    while ( !(input(SW_SEL) || input(SW_TRIG)) && !Remote ) {
+#if USE_RATE
+        if (!fb_task() && RatePos) { put_rate(RatePos, clk_rate()); }
+#else
+        fb_task();
+#endif
+        uart_task(FALSE);
+    }
+#elif USE_SLEEP
+    long idle;
+
+    idle = 0;
+    while ( !(input(SW_SEL) || input(SW_TRIG)) ) {
+        if (fb_task()) { continue; }
+#if USE_RATE
+        if (RatePos) {
+            put_rate(RatePos, clk_rate());
+            idle += 10;
+        }
+#endif
+        delay_ms(10);
+        if (++idle >= (long)SLEEP_SEC * 100) {
+            idle_sleep();
+            idle = 0;
+        }
+    }
+#else
+    while ( !(input(SW_SEL) || input(SW_TRIG)) ) {
+#if USE_RATE
+        if (!fb_task() && RatePos) { put_rate(RatePos, clk_rate()); }
+#else
+        fb_task();
+#endif
+    }
+#endif
+    delay_ms(50);
+}
+
+/* --------------------------------------------------------
+ * put_len()
+ * - Measurement length of TBI: "1E6", or "15min" (USE_TIME).
+ * -------------------------------------------------------- */
+void put_len() {
+#if USE_TIME
+    if (TBI >= TBI_BITS) {
+        printf(fb_putc, "%Lumin", tmin[TBI - TBI_BITS]);
+        return;
+    }
+#endif
+    printf(fb_putc, "1E%u", TBI + 3);
+}
+
+/* --------------------------------------------------------
+ * put_poly()
+ * - Pattern name of POLY_xxx p: "PN9", or "Word" (USE_WORD).
+ * -------------------------------------------------------- */
+void put_poly(int p) {
+#if USE_WORD
+    if (p == POLY_WORD) {
+        printf(fb_putc, "Word");
+        return;
+    }
+#endif
+    printf(fb_putc, "PN%u", pn_deg[p]);
+}
+
+#if USE_TEST
+/* --------------------------------------------------------
+ * self_test()
+ * - Power-on check of every compiled-in polynomial engine: pnX_test()
+ *   against its pn_crc[] (full period up to PN11, 4096 bits of PN15
+ *   and PN23; some 30 ms in all).
+ * - Needs TRISA set (fast_io): SYNC_LED must already be an output.
+ * - A mismatch shows the engine and both CRCs, blinks SYNC_LED and
+ *   goes no further: that engine would count errors against a wrong
+ *   sequence and still show a believable BER.
+ * - POLY_WORD has no fixed sequence to check.
+ * -------------------------------------------------------- */
+void self_test() {
+    int p;
+    long crc;
+
+    for (p = 0; p < POLY_WORD; p++) {
+        if (!pn_on[p]) { continue; }
 
+        switch (p) {
+#if USE_PN7
+            case POLY_PN7:  crc = pn7_test();  break;
+#endif
+#if USE_PN11
+            case POLY_PN11: crc = pn11_test(); break;
+#endif
+#if USE_PN15
+            case POLY_PN15: crc = pn15_test(); break;
+#endif
+#if USE_PN23
+            case POLY_PN23: crc = pn23_test(); break;
+#endif
+            default:        crc = pn9_test();  break;
+        }
+        if (crc == pn_crc[p]) { continue; }
+
+        printf(fb_putc, "\fSelf-test FAIL\n");
+        put_poly(p);
+        printf(fb_putc, " %04LX<>%04LX", crc, pn_crc[p]);
+        fb_flush();
+        while (TRUE) {
+            output_toggle(SYNC_LED);
+            delay_ms(250);
+        }
+    }
+}
+#endif
+
+#if USE_LOG
 /*
- * Test Bit count Index (TBI)
- * TotalBits is selected from tbit[] by TBI.
+ * Result log (USE_LOG), a ring of records in data EEPROM:
+ *   +0     sequence number 0..254, 0xFF = empty / being written
+ *   +1     Poly << 5 | SyncLoss (max 31)
+ *   +2..5  ErrorBits  (low byte first)
+ *   +6..9  CountBytes (low byte first)
+ * The slot after the newest record is the first one whose sequence
+ * number does not follow its predecessor, so no head pointer has to be
+ * rewritten on every run: each run writes one slot of the ring once,
+ * which spreads the wear over all of them.
  */
-int  TBI;
-long const tbit[6] = {1000, 5000, 10000, 30000, 50000, 65535};
+#define LOG_BASE    16
+#define LOG_REC     10
+#define LOG_N       11
+#define LOG_EMPTY   0xFF
 
-/* Speed optimization for PORTA I/O (CCS) */
-#use fast_io(a)
+int   LogHead;               // slot of the next record
+int   LogSeq;                // its sequence number
+
+int log_next(int s) {
+    if (++s == LOG_EMPTY) { s = 0; }
+    return s;
+}
+
+int32 log_read32(int a) {
+    return make32(read_eeprom(a + 3), read_eeprom(a + 2),
+                  read_eeprom(a + 1), read_eeprom(a));
+}
+
+/* --------------------------------------------------------
+ * log_init()
+ * - Finds LogHead / LogSeq after power-on.
+ * -------------------------------------------------------- */
+void log_init() {
+    int i, s, prev;
+
+    LogHead = 0;
+    LogSeq  = 0;
+    prev = read_eeprom(LOG_BASE);
+    if (prev == LOG_EMPTY) {
+        // new log, or slot 0 cut short: go on from the last slot
+        s = read_eeprom(LOG_BASE + (LOG_N - 1) * LOG_REC);
+        if (s != LOG_EMPTY) { LogSeq = log_next(s); }
+        return;
+    }
+
+    for (i = 1; i < LOG_N; i++) {
+        s = read_eeprom(LOG_BASE + i * LOG_REC);
+        if (s != log_next(prev)) { break; }
+        prev = s;
+    }
+    if (i == LOG_N) { i = 0; }               // full ring in order: 0 is oldest
+    LogHead = i;
+    LogSeq  = log_next(prev);
+}
+
+/* --------------------------------------------------------
+ * log_add()
+ * - End of countber(): the run into the next slot. The sequence number
+ *   is cleared first and written last, so a record cut short by a
+ *   power loss reads as empty. 11 EEPROM writes, about 45ms, with the
+ *   measurement already over.
+ * -------------------------------------------------------- */
+void log_add() {
+    int a, i, s;
+
+    a = LOG_BASE + LogHead * LOG_REC;
+    s = SyncLoss;
+    if (s > 31) { s = 31; }
+
+    write_eeprom(a, LOG_EMPTY);
+    write_eeprom(a + 1, (Poly << 5) | s);
+    for (i = 0; i < 4; i++) {
+        write_eeprom(a + 2 + i, ErrorBits.b[i]);
+        write_eeprom(a + 6 + i, CountBytes.b[i]);
+    }
+    write_eeprom(a, LogSeq);
+
+    LogSeq = log_next(LogSeq);
+    if (++LogHead == LOG_N) { LogHead = 0; }
+}
+
+/* --------------------------------------------------------
+ * log_show()
+ * - The records, newest first ("1" = last run):
+ *     1 PN9 1.23E-05
+ *     E=1234 L0
+ * - SW_SEL: older record, SW_TRIG: back to the menu.
+ * -------------------------------------------------------- */
+void log_show() {
+    int i, n, a, s;
+    int32 e;
+
+    i = LogHead;
+    for (n = 1; n <= LOG_N; n++) {
+        if (i == 0) { i = LOG_N; }
+        i--;
+        a = LOG_BASE + i * LOG_REC;
+        if (read_eeprom(a) == LOG_EMPTY) { break; }
+
+        s = read_eeprom(a + 1);
+        e = log_read32(a + 2);
+        fmt_ber(e, log_read32(a + 6));
+        printf(fb_putc, "\f%u ", n);
+        put_poly(s >> 5);
+        printf(fb_putc, " %s\nE=%Lu L%u", BerTxt, e, s & 31);
+
+        wait_release();
+        wait_key();
+#if USE_UART
+        if (Remote) { return; }
+#endif
+        if (input(SW_TRIG)) { return; }
+    }
+
+    if (n == 1) {
+        printf(fb_putc, "\fHistory\n(empty)");
+        wait_release();
+        wait_key();
+    }
+}
+#endif
 
 /* --------------------------------------------------------
  * setsetting()
  * - Called when SW_TRIG is pressed (case 2 in main loop).
- * - Cycles through measurement lengths (TotalBits).
- * - Waits for SW_SEL release to avoid repeated increment.
+ * - Small settings menu:
+ *     SW_TRIG : next item (after the last one: back to main screen)
+ *     SW_SEL  : change the value of the shown item
+ * - Items: measurement length (TBI), PN polynomial, mode, NRZ rate
+ *   (USE_NRZ, only in MODE_NRZ), sync threshold, data/clock polarity,
+ *   error injection (USE_INJ), BER limit (USE_EARLY), result history
+ *   (USE_LOG, SW_SEL browses it).
+ *   menu_on[] skips the items that are not compiled in.
+ * - Sync threshold steps through thr_tab[] (bits of matches to lock;
+ *   low = fast lock, high = no false lock on a noisy link).
+ * - Polarity steps D0-C0, D0-C1, D1-C0, D1-C1 (no power cycle needed).
+ * - Both keys on the main screen save everything to EEPROM as before.
  * -------------------------------------------------------- */
+#define MENU_LEN    0
+#define MENU_POLY   1
+#define MENU_MODE   2
+#define MENU_NRZ    3
+#define MENU_THRES  4
+#define MENU_POL    5
+#define MENU_INJ    6
+#define MENU_EARLY  7
+#define MENU_LOG    8
+#define MENU_ITEMS  9
+
+int const menu_on[MENU_ITEMS] = {TRUE, TRUE, TRUE, USE_NRZ, TRUE, TRUE, USE_INJ, USE_EARLY, USE_LOG};
+
+#define THR_COUNT   8
+int const thr_tab[THR_COUNT] = {8, 10, 16, 24, 32, 48, 64, 128};   // MODE_CAP: lock < CAP_LEN
+
 void setsetting() {
-    TBI++;
-    if (TBI == 6) { TBI = 0; }   // wrap-around
+    int item, i;
 
-    TotalBits = tbit[TBI];
+    item = 0;
+    while (item < MENU_ITEMS) {
+        if (!menu_on[item]) { item++; continue; }
+#if USE_NRZ
+        if (item == MENU_NRZ && Mode != MODE_NRZ) { item++; continue; }
+#endif
 
-    delay_ms(50);
-    while (input(SW_SEL));       // wait release (debounce-ish)
+        switch (item) {
+            case MENU_LEN:
+                printf(fb_putc, "\fLength\n");
+                put_len();
+                if (TBI < TBI_BITS) { printf(fb_putc, " bits"); }
+                break;
+            case MENU_POLY:
+                printf(fb_putc, "\fPolynomial\n");
+                put_poly(Poly);
+#if USE_WORD
+                if (Poly == POLY_WORD && WordLen) { printf(fb_putc, " %u bits", WordLen); }
+#endif
+                break;
+            case MENU_MODE:
+                if (Mode == MODE_CONT)      { printf(fb_putc, "\fMode\nContinuous"); }
+                else if (Mode == MODE_CAP)  { printf(fb_putc, "\fMode\nCapture"); }
+                else if (Mode == MODE_GEN)  { printf(fb_putc, "\fMode\nGenerator"); }
+                else if (Mode == MODE_LOOP) { printf(fb_putc, "\fMode\nLoopback"); }
+                else if (Mode == MODE_LANE) { printf(fb_putc, "\fMode\nLanes"); }
+                else if (Mode == MODE_NRZ)  { printf(fb_putc, "\fMode\nNRZ (no clock)"); }
+                else if (Mode == MODE_REP)  { printf(fb_putc, "\fMode\nRepeat"); }
+                else                        { printf(fb_putc, "\fMode\nBlock"); }
+                break;
+#if USE_NRZ
+            case MENU_NRZ: printf(fb_putc, "\fNRZ rate\n%Lu bit/s", nrz_rate[NrzSel]); break;
+#endif
+            case MENU_THRES: printf(fb_putc, "\fSync threshold\n%u bits", ThresError); break;
+            case MENU_POL:   printf(fb_putc, "\fPolarity\nD%u-C%u", DataNeg, ClockNeg); break;
+#if USE_INJ
+            case MENU_INJ:
+                if (InjSel) { printf(fb_putc, "\fInject\n1E-%u", InjSel + 2); }
+                else        { printf(fb_putc, "\fInject\nOff"); }
+                break;
+#endif
+#if USE_EARLY
+            case MENU_EARLY:
+                if (EarlySel) { printf(fb_putc, "\fBER limit\n1E-%u", EarlySel + 2); }
+                else          { printf(fb_putc, "\fBER limit\nOff"); }
+                break;
+#endif
+#if USE_LOG
+            case MENU_LOG: printf(fb_putc, "\fHistory\nSEL: browse"); break;
+#endif
+        }
+
+        wait_release();
+        wait_key();
+
+#if USE_UART
+        if (Remote) { return; }              // main() takes the remote key
+#endif
+        if (input(SW_TRIG)) { item++; continue; }
+
+        switch (item) {
+            case MENU_LEN:
+                TBI++;
+                if (TBI == TBI_COUNT) { TBI = 0; }   // wrap-around
+                break;
+
+            case MENU_POLY:
+                do {                         // next compiled-in polynomial
+                    Poly++;
+                    if (Poly == POLY_COUNT) { Poly = 0; }
+                } while (!pn_on[Poly]);
+                break;
+
+            case MENU_MODE:
+                do {                         // next compiled-in mode
+                    Mode++;
+                    if (Mode == MODE_COUNT) { Mode = 0; }
+                } while (!mode_on[Mode]);
+                break;
+
+#if USE_NRZ
+            case MENU_NRZ:
+                NrzSel++;
+                if (NrzSel == NRZ_COUNT) { NrzSel = 0; }
+                break;
+#endif
+
+            case MENU_THRES:
+                i = 0;                       // next table step above the value
+                while (i < THR_COUNT && thr_tab[i] <= ThresError) { i++; }
+                if (i == THR_COUNT) { i = 0; }
+                ThresError = thr_tab[i];
+                break;
+
+            case MENU_POL:
+                if (ClockNeg) { DataNeg = ~DataNeg; }
+                ClockNeg = ~ClockNeg;
+                break;
+
+#if USE_INJ
+            case MENU_INJ:
+                InjSel++;
+                if (InjSel == INJ_COUNT) { InjSel = 0; }
+                break;
+#endif
+
+#if USE_EARLY
+            case MENU_EARLY:
+                EarlySel++;
+                if (EarlySel == EARLY_COUNT) { EarlySel = 0; }
+                break;
+#endif
+
+#if USE_LOG
+            case MENU_LOG:
+                log_show();
+#if USE_UART
+                if (Remote) { return; }
+#endif
+                break;
+#endif
+        }
+    }
 }
 
 /* --------------------------------------------------------
  * countber()
- * Two-phase operation:
+ * Two-phase operation (both in the pnX_count() engine, pn_loop.c):
  *
  * (1) Sync/Lock phase:
- *   - Attempts to align LFSR expected bit with incoming DATA.
- *   - If mismatch occurs, it flips tap[15] (expected output bit)
- *     and resets the consecutive counter.
- *   - Once it achieves ThresError consecutive "matches",
- *     it declares sync and turns SYNC_LED ON.
+ *   - Seeds the LFSR with the first N received bits (N = register
+ *     length), so no flip-and-retry is needed to find the phase.
+ *   - Then the next received bits must match the generator; a mismatch
+ *     seeds it again and resets the consecutive counter.
+ *   - Once it achieves ThresError consecutive "matches" (checked in
+ *     whole bytes), it declares sync and turns SYNC_LED ON.
+ *   - Lock takes about N + ThresError clocks on a clean line.
  *
  * (2) Count phase:
- *   - Runs TotalBits comparisons and increments ErrorBits on mismatch.
+ *   - Packs DATA_IN into RxByte; rx_byte() compares 8 bits at a time
+ *     against pnX_next() until TotalBytes have been counted.
+ *   - More than LOS_ERRS errors in the last 64 bits: loss of sync,
+ *     SYNC_LED OFF and back to (1) (relock(), counted in SyncLoss).
  *
  * Sampling:
  *   - Waits for the configured clock edge:
  *       while(!input(CLK_IN) ^ ClockNeg)   // wait rising (considering inversion)
- *     then reads DATA and compares with tap[15] (expected bit).
+ *     then reads DATA.
  *   - Waits for clock to go low again before next iteration.
  *
  * NOTE:
  * - The XOR with DataNeg / ClockNeg provides polarity inversion support.
+ *   DataNeg is applied once per byte (DataMask).
+ * - With ENGINE_TMR0 both phases are clocked by clk_isr(), and ClockNeg
+ *   selects the TMR0 counting edge (T0SE) instead of being XORed per bit.
+ * - AUTO_POL: sync also accepts the inverted data and changes the clock
+ *   edge when it cannot lock; DataNeg/ClockNeg are left as found.
  * -------------------------------------------------------- */
 void countber() {
-    printf(lcd_putc, "\fCounting...\n...");
+#if USE_LANE
+    int i;
+#endif
+
+#if USE_GEN
+    if (Mode == MODE_GEN) {
+        fb_putc('\f');
+        put_poly(Poly);
+        printf(fb_putc, " out\nSEL: stop");
+    } else
+#endif
+    printf(fb_putc, "\fCounting...\n...");
 
     RenzokuError = 0;
-    ErrorBits = 0;
-    CountBits = 0;
+    ErrorBits.w  = 0;
+    CountBytes.w = 0;
+    TotalBytes   = 0;                        // MODE_CONT, lengths in time
+    if (TBI < TBI_BITS && Mode != MODE_CONT) { TotalBytes = tbyte[TBI]; }
+#if USE_REP
+    RepTbi       = TBI;
+    if (TBI >= TBI_BITS) { RepTbi = REP_TBI; }
+    if (Mode == MODE_REP) { TotalBytes = tbyte[RepTbi]; }
+    SnapSeq      = 0;
+    SnapDue      = FALSE;
+    RepEnd       = FALSE;
+    RepDue       = FALSE;
+#endif
+    TotalLo      = make8(TotalBytes, 0);
+
+    SyncLoad = 0;
+#if AUTO_POL
+    SyncTry  = 0;
+#endif
+#if USE_WORD
+    // A new word is learned, except for sending the last one
+    if (Poly == POLY_WORD && Mode != MODE_GEN && Mode != MODE_LOOP) {
+        word_period(0);
+        WordLen = 0;
+    }
+#endif
+    SyncLoss = 0;
+    los_reset();
+#if USE_HIST
+    hist_sync(TRUE);
+#endif
+#if USE_UART
+    StopReq  = FALSE;
+#endif
+#if USE_OVR
+    Overrun  = 0;
+#endif
+#if USE_INJ
+    InjOn    = (InjSel != 0);
+    if (InjOn) { InjPer = tbyte[InjSel - 1]; }
+    InjLeft  = InjPer;
+#endif
+#if USE_LANE
+    for (i = 0; i < LANE_N; i++) { LaneErr[i] = 0; }
+    if (Mode == MODE_LANE) { TRISB |= LANE_PINS; }   // lcd_u.c sets them back
+#endif
+#if USE_EARLY
+    if (EarlySel && Mode != MODE_REP) { early_init(tbyte[EarlySel - 1]); }
+    else                              { early_init(0); }
+#endif
+
+    DataMask = 0;
+    if (DataNeg ^ pn_inv[Poly]) { DataMask = 0xFF; }
+    RxLeft = 8;
 
     output_low(SYNC_LED);
+    fb_flush();
+#if USE_RATE
+    RunRate = clk_rate();                    // part of the settle delay
+    delay_ms(400);
+#else
     delay_ms(500);
+#endif
+#if USE_TIME
+    time_init();                             // Timer1 after the rate gate
+#endif
+#if USE_PROF
+    prof_init();
+#endif
+#if USE_NRZ
+    if (Mode == MODE_NRZ) {
+        nrz_init();
+#if USE_RATE
+        RunRate = nrz_rate[NrzSel];          // nominal, there is no CLK_IN
+#endif
+    }
+#endif
 
-    /* -------- Sync phase --------
-     * RenzokuError is used as the "consecutive match counter".
-     * The for-loop variable is re-used intentionally; mismatches reset it.
-     */
-    for (RenzokuError = 0; RenzokuError < ThresError; RenzokuError++) {
+#if BERT_ENGINE == ENGINE_TMR0
+    RxHead = 0;
+    RxTail = 0;
+    live_init();
 
-        // Wait for (logical) rising edge
-        while ( (!input(CLK_IN)) ^ ClockNeg );
+    clk_edge();
 
-        // Compare expected bit (tap[15]) with incoming DATA (polarity applied)
-        if ( tap[15] == (input(DATA_IN) ^ DataNeg) ) {
-            // match: do nothing
-        } else {
-            // mismatch: reset consecutive counter and flip expected bit to realign
-            RenzokuError = 0;
-            tap[15] = ~tap[15];
-        }
+    set_timer0(0xFF);
+    clear_interrupt(INT_RTCC);
+    enable_interrupts(INT_RTCC);
+#if USE_TIME
+    TickDue = 0;
+    clear_interrupt(INT_CCP1);
+    enable_interrupts(INT_CCP1);
+#endif
+    enable_interrupts(GLOBAL);
+#else
+#if POLL_LIVE
+    LivePoll = ((Mode == MODE_CONT || Mode == MODE_REP) &&
+                RunRate != 0 && RunRate <= LIVE_MAX);
+    if (LivePoll) {
+        live_init();
+        fb_flush();                          // before the clock matters
+    }
+#endif
+#if USE_OVR
+    clk_edge();                              // TMR0 counts the edges alongside
+#endif
+#if USE_UART
+    // No interrupts between the edge waits; uart_stop() polls instead
+    disable_interrupts(GLOBAL);
+#endif
+#endif
 
-        // Wait for (logical) falling edge / clock low
-        while ( (input(CLK_IN)) ^ ClockNeg );
+    switch (Poly) {
+#if USE_PN7
+        case POLY_PN7:  pn7_count();  break;
+#endif
+#if USE_PN11
+        case POLY_PN11: pn11_count(); break;
+#endif
+#if USE_PN15
+        case POLY_PN15: pn15_count(); break;
+#endif
+#if USE_PN23
+        case POLY_PN23: pn23_count(); break;
+#endif
+#if USE_WORD
+        case POLY_WORD: word_count(); break;
+#endif
+        default:        pn9_count();  break;
+    }
 
-        // Advance LFSR state
-        shift_right(tap, 2, tap[7] ^ tap[11]);
+#if USE_HIST
+    if (BurstBits) { hist_burst(); }         // burst still open at the end
+#endif
+#if USE_REP
+    // The result is the last full block (the one stopped is dropped)
+    if (Mode == MODE_REP && SnapSeq) {
+        ErrorBits.w  = SnapErr;
+        CountBytes.w = tbyte[RepTbi];        // every snapshot is a full block
+        SyncLoss     = SnapLoss;
     }
+#endif
 
-    output_high(SYNC_LED);
+#if BERT_ENGINE == ENGINE_TMR0
+    disable_interrupts(INT_RTCC);
+#if USE_TIME
+    disable_interrupts(INT_CCP1);
+#endif
+#endif
+#if USE_UART
+    enable_interrupts(GLOBAL);               // serial.c runs on interrupts
+#else
+    disable_interrupts(GLOBAL);
+#endif
+#if USE_TIME
+    while (SecStep) { sec_step(); }          // a second closed on the last bytes
+#endif
 
-    /* -------- Count phase -------- */
-    for (CountBits = 0; CountBits < TotalBits; CountBits++) {
+#if AUTO_POL
+    // Keep the data polarity sync locked on (ClockNeg is already set)
+    DataNeg = (DataMask != 0) ^ pn_inv[Poly];
+#endif
 
-        while ( (!input(CLK_IN)) ^ ClockNeg );
+#if USE_LOG
+    if (CountBytes.w && Mode != MODE_GEN) { log_add(); }
+#endif
+}
 
-        if ( tap[15] == (input(DATA_IN) ^ DataNeg) ) {
-            // match: do nothing
-        } else {
-            // mismatch: count error
-            ErrorBits++;
+#if USE_TIME
+/* --------------------------------------------------------
+ * show_time()
+ * - Seconds since lock and the G.821 counts; waits for a key.
+ * -------------------------------------------------------- */
+void show_time() {
+    printf(fb_putc, "\fT=%Lus ES=%Lu\nSES=%Lu UAS=%Lu",
+           TotalSec, EsSec, SesSec, UaSec);
+    wait_release();
+    wait_key();
+}
+#endif
+
+#if USE_HIST
+/* --------------------------------------------------------
+ * show_hist()
+ * - The non-empty histogram bins, two per screen:
+ *     B>=n:count   bursts of n .. 2n-1 error bits
+ *     G>=n:count   gaps of n .. 2n-1 clean bits (whole bytes)
+ *   The last bin of each also holds everything above.
+ * - SW_SEL: next screen, SW_TRIG: back.
+ * -------------------------------------------------------- */
+void show_hist() {
+    int i, line;
+    long c;
+
+    line = 0;
+    for (i = 0; i < BURST_BINS + GAP_BINS; i++) {
+        if (i < BURST_BINS) { c = BurstHist[i]; }
+        else                { c = GapHist[i - BURST_BINS]; }
+        if (c == 0) { continue; }
+
+        if (line == 0) { fb_putc('\f'); }
+        else           { fb_putc('\n'); }
+
+        if (i < BURST_BINS) { printf(fb_putc, "B>=%Lu:%Lu", (long)1 << i, c); }
+        else                { printf(fb_putc, "G>=%Lu:%Lu", (long)8 << (i - BURST_BINS), c); }
+
+        if (++line == 2) {
+            line = 0;
+            wait_release();
+            wait_key();
+            if (input(SW_TRIG)) { return; }
         }
+    }
+
+    if (line) {
+        wait_release();
+        wait_key();
+    }
+}
+#endif
+
+#if USE_LANE
+/* --------------------------------------------------------
+ * show_lanes()
+ * - BER of RB4..RB7 over the bits DATA_IN counted, two per screen:
+ *     L1 BER=1.23E-05   (L1..L4 = RB4..RB7)
+ * - SW_SEL: next screen, SW_TRIG: back.
+ * -------------------------------------------------------- */
+void show_lanes() {
+    int i;
 
-        while ( (input(CLK_IN)) ^ ClockNeg );
+    for (i = 0; i < LANE_N; i++) {
+        fmt_ber(LaneErr[i], CountBytes.w);
+        if (i & 1) { fb_putc('\n'); }
+        else       { fb_putc('\f'); }
+        printf(fb_putc, "L%u BER=%s", i + 1, BerTxt);
 
-        shift_right(tap, 2, tap[7] ^ tap[11]);
+        if (i & 1) {
+            wait_release();
+            wait_key();
+            if (input(SW_TRIG)) { return; }
+        }
     }
 }
+#endif
+
+#if USE_PROF
+/* --------------------------------------------------------
+ * show_prof()
+ * - Spare cycles per bit of the last run (USE_PROF):
+ *     Spare min=12      (the tightest bit, the longest step)
+ *     max=180 cycles
+ * - Waits for a key.
+ * -------------------------------------------------------- */
+void show_prof() {
+    printf(fb_putc, "\fSpare min=%Lu\nmax=%Lu cycles",
+           prof_spare(ProfMin), prof_spare(ProfMax));
+    wait_release();
+    wait_key();
+}
+#endif
 
 /* --------------------------------------------------------
  * show_ber()
- * - Displays BER (%) and raw counters on LCD.
+ * - Displays BER and raw counters on LCD.
+ *   BER is printed in exponent form by fmt_ber(); %lf in percent has
+ *   no digits left for runs down to 1E-10.
+ * - MODE_CONT runs have no fixed length: the bit count is shown in kbit.
+ * - MODE_REP: the last full block and its number ("#n"; #0 when the
+ *   first block was stopped).
+ * - "Ln" after the BER: sync was lost and re-locked n times.
+ * - USE_OVR: "OVERRUN n" instead of the BER when edges were missed.
+ * - USE_EARLY with a limit (not in MODE_REP): PASS / FAIL / OPEN
+ *   (early_verdict()) instead of the length.
  * - Waits for either key.
  * - If SW_TRIG is pressed, immediately runs another measurement (countber()).
+ * - SW_SEL goes through show_lanes() (MODE_LANE), show_prof()
+ *   (USE_PROF, after counted bits), show_time()
+ *   (USE_TIME, once locked) and show_hist() (USE_HIST, when there were
+ *   errors) first.
  * -------------------------------------------------------- */
 void show_ber() {
-    float fEB, fCB;
+    fmt_ber(ErrorBits.w, CountBytes.w);
+#if USE_OVR
+    if (Overrun) {
+        // Edges were missed: the errors are the tester's, not the line's
+        printf(fb_putc, "\fOVERRUN %u", Overrun);
+    } else
+#endif
+    {
+        printf(fb_putc, "\fBER=%s", BerTxt);
+        if (SyncLoss) { printf(fb_putc, " L%u", SyncLoss); }
+    }
+    fb_putc('\n');
 
-    fCB = CountBits;   // convert to float
-    fEB = ErrorBits;
+#if USE_UART
+    printf(ser_putc, "R,%u,%08LX,%08LX,%u,%s", pn_deg[Poly],
+           ErrorBits.w, CountBytes.w, SyncLoss, BerTxt);
+#if USE_RATE
+    printf(ser_putc, ",%08LX", RunRate);
+#endif
+#if USE_OVR
+    printf(ser_putc, ",%u", Overrun);
+#endif
+#if USE_EARLY
+    if (EarlyOn) { printf(ser_putc, ",%c", early_code[early_verdict(tbyte[EarlySel - 1])]); }
+#endif
+    printf(ser_putc, "\r\n");
+#if USE_TIME
+    printf(ser_putc, "T,%08LX,%04LX,%04LX,%04LX\r\n",
+           TotalSec, EsSec, SesSec, UaSec);
+#endif
+#if USE_LANE
+    if (Mode == MODE_LANE) {
+        printf(ser_putc, "N,%08LX,%08LX,%08LX,%08LX\r\n",
+               LaneErr[0], LaneErr[1], LaneErr[2], LaneErr[3]);
+    }
+#endif
+#if USE_PROF
+    if (ProfMin != PROF_NONE) {
+        printf(ser_putc, "D,%04LX,%04LX\r\n",
+               prof_spare(ProfMin), prof_spare(ProfMax));
+    }
+#endif
+#endif
 
-    // FIX: missing comma after format string in the original text
-    printf(lcd_putc,
-           "\fBER=%lf%% \nE=%5lu C=%5lu",
-           ( (fEB / fCB) * 100.0 ),
-           ErrorBits, CountBits);
+#if USE_EARLY
+    if (EarlyOn) {
+        printf(fb_putc, "E=%Lu ", ErrorBits.w);
+        switch (early_verdict(tbyte[EarlySel - 1])) {
+            case EARLY_PASS: printf(fb_putc, "PASS"); break;
+            case EARLY_FAIL: printf(fb_putc, "FAIL"); break;
+            default:         printf(fb_putc, "OPEN"); break;
+        }
+    } else
+#endif
+#if USE_REP
+    if (Mode == MODE_REP) {
+        printf(fb_putc, "E=%Lu #%Lu", ErrorBits.w, SnapSeq);
+    } else
+#endif
+    if (Mode == MODE_CONT) {
+        printf(fb_putc, "E=%Lu %Lukb", ErrorBits.w, CountBytes.w / 125);
+    } else {
+        printf(fb_putc, "E=%Lu /", ErrorBits.w);
+        put_len();
+    }
+#if USE_RATE
+    if (FbPos <= 26) { put_rate(27, RunRate); }   // if line 2 has room
+#endif
 
-    // Wait for any key
-    while ( !(input(SW_SEL) || input(SW_TRIG)) );
-    delay_ms(50);
+    // Wait for any key (the MODE_CONT stop key may still be held)
+    wait_release();
+    wait_key();
 
-    // Trigger key repeats measurement
+    // Select key: more result screens (lanes, seconds, error structure)
+#if USE_LANE
+    if (input(SW_SEL) && Mode == MODE_LANE) {
+        show_lanes();
+        if (input(SW_TRIG)) { return; }
+    }
+#endif
+#if USE_PROF
+    if (input(SW_SEL) && ProfMin != PROF_NONE) {
+        show_prof();
+        if (input(SW_TRIG)) { return; }
+    }
+#endif
+#if USE_TIME
+    if (input(SW_SEL) && TimeOn) {
+        show_time();
+        if (input(SW_TRIG)) { return; }
+    }
+#endif
+#if USE_HIST
+    if (input(SW_SEL) && ErrorBits.w) {
+        show_hist();
+        return;
+    }
+#endif
+
+    // Trigger key repeats measurement (a remote key goes back to main())
     if (input(SW_TRIG)) { countber(); }
 }
 
@@ -221,6 +2675,7 @@ void show_ber() {
  * Startup behavior:
  * - Init LCD
  * - Setup TRIS for PORTA (A0,A1,A4,A5 inputs; A2,A3 outputs)
+ * - USE_TEST: self_test() of the PN engines (halts on a failure)
  * - Read settings from EEPROM
  * - Optional polarity toggle:
  *    - Power-on with SW_TRIG held: invert DataNeg
@@ -228,22 +2683,53 @@ void show_ber() {
  *
  * UI (two buttons):
  * - SW_SEL: start measurement / show screen
- * - SW_TRIG: change setting (measurement length)
+ * - SW_TRIG: settings menu (length, polynomial, mode, threshold, polarity)
  * - Both pressed: save settings to EEPROM
+ * - USE_UART: the same from the host (S / L,P,M / W), see uart_task()
  * -------------------------------------------------------- */
 void main() {
+    int key;
+
     delay_ms(50);
     lcd_init();
+    fb_init();
 
     // A0,A1,A4,A5 inputs; A2,A3 outputs (1=input, 0=output)
     set_tris_a(0b00110011);
+#if USE_TEST
+    self_test();                             // after TRISA: SYNC_LED (RA3) is an output
+#endif
 
     // Load settings from EEPROM
     ClockNeg   = read_eeprom(0);
     DataNeg    = read_eeprom(1);
     TBI        = read_eeprom(2);
-    TotalBits  = tbit[TBI];
+    if (TBI >= TBI_COUNT) { TBI = 2; }
     ThresError = read_eeprom(3);
+    if (ThresError > thr_tab[THR_COUNT - 1]) { ThresError = thr_tab[THR_COUNT - 1]; }
+    Poly       = read_eeprom(4);
+    if (Poly >= POLY_COUNT || !pn_on[Poly]) { Poly = POLY_PN9; }
+    Mode       = read_eeprom(5);
+    if (Mode >= MODE_COUNT || !mode_on[Mode]) { Mode = MODE_BLOCK; }
+#if USE_INJ
+    InjSel     = read_eeprom(6);
+    if (InjSel >= INJ_COUNT) { InjSel = 0; }
+#endif
+#if USE_EARLY
+    EarlySel   = read_eeprom(7);
+    if (EarlySel >= EARLY_COUNT) { EarlySel = 0; }
+#endif
+#if USE_NRZ
+    NrzSel     = read_eeprom(8);
+    if (NrzSel >= NRZ_COUNT) { NrzSel = 3; }
+#endif
+#if USE_LOG
+    log_init();
+#endif
+#if USE_WORD
+    word_period(0);
+    WordLen = 0;
+#endif
 
     output_low(SYNC_LED);
 
@@ -251,45 +2737,82 @@ void main() {
     if (input(SW_TRIG)) { DataNeg  = ~DataNeg; }
     if (input(SW_SEL )) { ClockNeg = ~ClockNeg; }
 
+#if USE_UART
+    ser_init();
+    enable_interrupts(GLOBAL);
+    uart_settings();
+#endif
+
     while (TRUE) {
         // Wait until both switches are released
-        while ( input(SW_SEL) || input(SW_TRIG) );
-        delay_ms(50);
+        wait_release();
 
-        // FIX: missing commas in original text (likely copy/paste artifact)
-        printf(lcd_putc,
-               "\fBERT PN9 D%u-C%u\nT:%Lu S:%u",
-               DataNeg, ClockNeg, TotalBits, ThresError);
+        fb_putc('\f');
+        put_poly(Poly);
+        printf(fb_putc, " D%u-C%u\nT:", DataNeg, ClockNeg);
+        put_len();
+        printf(fb_putc, " S:%u", ThresError);
+#if USE_INJ
+        if (InjSel) { printf(fb_putc, " I%u", InjSel + 2); }   // injecting 1E-n
+#endif
 
-        // Wait for any key
-        while ( !(input(SW_SEL) || input(SW_TRIG)) );
-        delay_ms(50); // debounce
+        // Wait for any key (USE_RATE: clock rate at the end of line 1)
+#if USE_RATE
+        RatePos = 11;
+        wait_key();
+        RatePos = 0;
+#else
+        wait_key();
+#endif
 
         // Determine which key(s) are pressed:
         //   SW_SEL  -> 1
         //   SW_TRIG -> 2
         //   Both    -> 3
-        switch ( input(SW_SEL) + input(SW_TRIG)*2 ) {
+        //   (USE_UART: Remote gives the same codes, 4 = redraw only)
+        key = input(SW_SEL) + input(SW_TRIG)*2;
+#if USE_UART
+        if (Remote) {
+            key    = Remote;
+            Remote = 0;
+        }
+#endif
+        switch (key) {
 
             case 1:
-                // Measure + show results
+                // Measure + show results (MODE_GEN: nothing to show)
                 countber();
+#if USE_GEN
+                if (Mode == MODE_GEN) { break; }
+#endif
                 show_ber();
                 break;
 
             case 2:
-                // Change measurement length (TotalBits)
+                // Settings menu (length, Poly, Mode, threshold, polarity)
                 setsetting();
                 break;
 
             case 3:
                 // Save settings to EEPROM
-                printf(lcd_putc, "\fsave settings...\n%s", __DATE__);
+                printf(fb_putc, "\fsave settings...\n%s", __DATE__);
+                fb_flush();
 
                 write_eeprom(0, ClockNeg);
                 write_eeprom(1, DataNeg);
                 write_eeprom(2, TBI);
                 write_eeprom(3, ThresError);
+                write_eeprom(4, Poly);
+                write_eeprom(5, Mode);
+#if USE_INJ
+                write_eeprom(6, InjSel);
+#endif
+#if USE_EARLY
+                write_eeprom(7, EarlySel);
+#endif
+#if USE_NRZ
+                write_eeprom(8, NrzSel);
+#endif
 
                 delay_ms(100);
                 break;
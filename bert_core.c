@@ -0,0 +1,567 @@
+/*
+ * bert_core.c
+ * Count phase core of BERT.c (CCS C): rx_byte() and its steps,
+ * los_reset(), relock(), the early end (USE_EARLY), the learned
+ * word's period (USE_WORD), the NRZ bit phase (USE_NRZ), back-to-back
+ * blocks (USE_REP), the error histogram, fmt_ber() / ber_txt() and
+ * crc16().
+ *
+ * Portable on purpose: no SFRs, no #asm, no CCS built-ins beyond
+ * make8(), input() / output_low() on named pins and sprintf(). host/
+ * builds it together with pn_loop.c against synthetic streams to check
+ * that the engines still count the same. Things the core needs from
+ * the firmware:
+ *   TIME_POLL(), uart_stop(), Mode / MODE_CONT / MODE_REP,
+ *   LiveDue, SYNC_LED,
+ *   SW_SEL, and USE_TIME's SecLos / Locked / SecErr0 / SecByte0.
+ */
+
+#if USE_HIST
+/* --------------------------------------------------------
+ * log2_8()
+ * - floor(log2(b)) of a byte with two nibble lookups (no loop).
+ * -------------------------------------------------------- */
+int log2_8(int b) {
+    if (b & 0xF0) { return 4 + lg4[b >> 4]; }
+    return lg4[b];
+}
+
+/* --------------------------------------------------------
+ * hist_burst() / hist_gap()
+ * - Close the open burst / gap into its bin. Called by rx_los() only
+ *   on the first byte after a burst or a gap, in a fixed number
+ *   of cycles.
+ * -------------------------------------------------------- */
+void hist_burst() {
+    int i;
+
+    i = log2_8(BurstBits);
+    if (++BurstHist[i] == 0) { BurstHist[i]--; }
+    BurstBits = 0;
+    GapCnt    = 0;
+    HistOn    = TRUE;
+}
+
+void hist_gap() {
+    int i;
+
+    if (HistOn) {
+        if (make8(GapCnt, 1)) { i = 8 + log2_8(make8(GapCnt, 1)); }
+        else                  { i = log2_8(make8(GapCnt, 0)); }
+        if (i >= GAP_BINS) { i = GAP_BINS - 1; }
+        if (++GapHist[i] == 0) { GapHist[i]--; }
+    }
+    GapCnt = 0;
+}
+
+/* --------------------------------------------------------
+ * hist_sync()
+ * - (Re)lock: no burst or gap open; a gap is only counted after the
+ *   first burst. clear: empty the bins as well (new run).
+ * -------------------------------------------------------- */
+void hist_sync(short clear) {
+    int i;
+
+    if (clear) {
+        for (i = 0; i < BURST_BINS; i++) { BurstHist[i] = 0; }
+        for (i = 0; i < GAP_BINS; i++)   { GapHist[i] = 0; }
+    }
+    BurstBits = 0;
+    GapCnt    = 0;
+    HistOn    = FALSE;
+}
+#endif
+
+#if USE_WORD
+/* --------------------------------------------------------
+ * word_period()
+ * - Period candidate p for the learned word; out of range (0 at the
+ *   start of a run, WORD_MAX + 1 after the last) starts at WORD_MIN.
+ * -------------------------------------------------------- */
+void word_period(int p) {
+    if (p < WORD_MIN || p > WORD_MAX) { p = WORD_MIN; }
+    WordP = p;
+    WordQ = p >> 3;
+    WordR = p & 7;
+}
+#endif
+
+#if USE_NRZ
+/* --------------------------------------------------------
+ * nrz_sample()
+ * - One DATA_IN sample s of MODE_NRZ. A change of s makes this sample
+ *   the first of a bit, unless it came late (its time is not known);
+ *   sample NRZ_MID, 1/2 to 3/4 of a bit after the transition, is the
+ *   bit. Without changes a bit follows every NRZ_OVS samples.
+ * - Returns the bit, or NRZ_NONE.
+ * -------------------------------------------------------- */
+int nrz_sample(short s, short late) {
+    int ph;
+
+    if (s != NrzLast) {
+        NrzLast = s;
+        if (!late) { NrzPh = 0; }
+    }
+    ph = NrzPh;
+    NrzPh = (NrzPh + 1) & (NRZ_OVS - 1);
+    if (ph == NRZ_MID) { return s; }
+    return NRZ_NONE;
+}
+#endif
+
+#if USE_REP
+/* --------------------------------------------------------
+ * rep_block() / rep_next()
+ * - rx_end() at the end of a MODE_REP block: the counters go into
+ *   the snapshot and start again from 0. The LFSR, the LOS window and
+ *   the histograms carry on as if the block had not ended.
+ * - rep_block() only does what has to be done before the next byte is
+ *   counted; the rest is rep_next(), from rx_wrap() one byte later
+ *   (RepDue), still before rx_time() can close a second.
+ * - USE_TIME: the start of the second moves down by the same amount,
+ *   so the second's error / byte counts run on across the block end.
+ * - The stop key / remote stop is also read here, so that blocks
+ *   shorter than 256 bytes (TBI 0: 125 bytes) can be stopped too: the
+ *   block just taken is then the result. Returns TRUE in that case.
+ * -------------------------------------------------------- */
+void rep_next() {
+    RepDue    = FALSE;
+    SnapLoss  = SyncLoss;
+    SyncLoss  = 0;
+    SnapSeq++;
+    SnapDue   = TRUE;
+#if USE_TIME
+    SecErr0  -= (long)SnapErr;
+    SecByte0 -= (long)TotalBytes;
+#endif
+}
+
+short rep_block() {
+    SnapErr      = ErrorBits.w;
+    ErrorBits.w  = 0;
+    CountBytes.w = 0;
+    RepDue       = TRUE;
+
+    if (input(SW_SEL) || uart_stop()) {
+        RepEnd = TRUE;
+        rep_next();
+        return TRUE;
+    }
+    return FALSE;
+}
+#endif
+
+#if USE_EARLY
+/* --------------------------------------------------------
+ * early_init()
+ * - per: bytes per error at the limit (1/(8L)), 0 = no early end.
+ *   At the start of every run, before the count phase.
+ * -------------------------------------------------------- */
+void early_init(int32 per) {
+    EarlyOn  = (per != 0);
+    FailStep = per >> 1;
+    PassStep = per + (per >> 1) + (per >> 2);
+    FailAt   = 0;
+    PassAt   = per * 3;
+    EarlyPend = 0;
+    EarlyFail = FALSE;
+}
+
+/* --------------------------------------------------------
+ * early_err()
+ * - n more error bits (rx_err(), error bytes only), queued for
+ *   early_step(), and whether the LOS window before this byte was
+ *   clean: the first errors of a slip must not end the run before
+ *   relock() takes them back.
+ * - A queue that would overflow (errors on every byte) saturates, and
+ *   so does PassAt: such a run can no longer PASS.
+ * -------------------------------------------------------- */
+void early_err(int n) {
+    EarlyClean = (LosSum == 0);
+    EarlyPend += n;
+    if (EarlyPend < n) {
+        EarlyPend = 0xFFFF;
+        PassAt    = 0xFFFFFFFF;
+    }
+}
+
+/* --------------------------------------------------------
+ * early_step()
+ * - rx_early(), a byte while EarlyPend: one queued error bit into
+ *   both bounds, then the FAIL test. A FAIL ends the run on this byte
+ *   (TotalBytes = CountBytes, for rx_end(); rx_wrap() has carried it).
+ * - A bound from 2^31 on is saturated: no run counts that many bytes,
+ *   and it then stays as it is. That is one bit test instead of a
+ *   32-bit compare per bound, and the add cannot wrap: below 2^31,
+ *   Per (and so the step) is small enough.
+ * - The FAIL test only while the last error byte had a clean LOS
+ *   window before it (EarlyClean).
+ * -------------------------------------------------------- */
+void early_step() {
+    EarlyPend--;
+    if (!(make8(FailAt, 3) & 0x80)) { FailAt += FailStep; }
+    if (!(make8(PassAt, 3) & 0x80)) { PassAt += PassStep; }
+
+    if (!EarlyClean) { return; }
+    if (ErrorBits.w >= EARLY_ERRS ||
+        (ErrorBits.w >= EARLY_MIN && CountBytes.w < FailAt)) {
+        TotalBytes = CountBytes.w;
+        TotalLo    = make8(TotalBytes, 0);
+        EarlyFail  = TRUE;
+    }
+}
+
+/* --------------------------------------------------------
+ * early_verdict()
+ * - After the run, per as given to early_init():
+ *   EARLY_FAIL: early_step() ended the run (EARLY_ERRS reached, even
+ *               with a BER below the limit), or the BER of the run is
+ *               above the limit,
+ *   EARLY_PASS: below it with the PassAt confidence (error bits still
+ *               queued for PassAt, EarlyPend, rule it out),
+ *   EARLY_OPEN: neither (stopped or too short for the limit).
+ * -------------------------------------------------------- */
+int early_verdict(int32 per) {
+    if (EarlyFail || ErrorBits.w > CountBytes.w / per) { return EARLY_FAIL; }
+    if (!EarlyPend && CountBytes.w >= PassAt) { return EARLY_PASS; }
+    return EARLY_OPEN;
+}
+
+/* --------------------------------------------------------
+ * early_undo()
+ * - relock(): the n error bits of a slip are taken back out of the
+ *   bounds as well, the queued ones first (a saturated bound stays
+ *   saturated).
+ * -------------------------------------------------------- */
+void early_undo(int n) {
+    if (EarlyPend >= n) {
+        EarlyPend -= n;
+        return;
+    }
+    n -= (int)EarlyPend;
+    EarlyPend = 0;
+    while (n--) {
+        if (!(make8(FailAt, 3) & 0x80)) { FailAt -= FailStep; }
+        if (!(make8(PassAt, 3) & 0x80)) { PassAt -= PassStep; }
+    }
+}
+#endif
+
+/*
+ * Count phase, per received byte. rx_cmp() is the work that has to be
+ * done at the byte boundary; the rest is in steps small enough for one
+ * of the gaps between the bits of the next byte, in this order:
+ *   gap 8  rx_cmp()    compare, count the byte
+ *   gap 2  rx_err()    error bits: ErrorBits, early_err()
+ *   gap 3  rx_los()    LOS window, USE_HIST histogram
+ *   gap 4  rx_wrap()   every 256 bytes: carry, stop key, PASS;
+ *                      USE_REP: rep_next() after a block end
+ *   gap 5  rx_early()  USE_EARLY: one early_step()
+ *   gap 6  rx_time()   USE_TIME: TIME_POLL()
+ *   gap 7  rx_end()    end of the block / loss of sync
+ * (gap 1 is PN_FN(next)()). The ENGINE_POLL count loops call them so;
+ * every other loop calls rx_byte(), all of them at once. Between the
+ * bytes the steps keep their state in RxErr / RxWrap / RxDue (and
+ * RepDue).
+ * All steps of a byte run before the next rx_cmp(), so they see the
+ * counters as rx_byte() does. rx_early() comes after rx_wrap(): a FAIL
+ * on the byte that carries takes the carried CountBytes. rx_time()
+ * comes after rx_wrap(): no second is closed between rep_block() and
+ * rep_next().
+ */
+
+/* --------------------------------------------------------
+ * rx_cmp()
+ * - r: received bits, oldest in bit 7, DataNeg not applied yet
+ *   (DataMask does the polarity for all 8 bits with one XOR).
+ * - The caller loads PnExp with the next expected byte afterwards.
+ * - Only the XOR and the low byte of CountBytes: the error bits stay
+ *   in RxErr as a mask, the carry in RxWrap.
+ * -------------------------------------------------------- */
+void rx_cmp(int r) {
+    RxErr = r ^ DataMask ^ PnExp;            // 1 = bit error
+    if (++CountBytes.b[0] == 0) { RxWrap = TRUE; }
+    RxDue = TRUE;
+}
+
+/* --------------------------------------------------------
+ * rx_err()
+ * - The mask in RxErr becomes its number of error bits, added to
+ *   ErrorBits. USE_EARLY: early_err() queues them (before rx_los()
+ *   has put them into the window).
+ * -------------------------------------------------------- */
+void rx_err() {
+    int n;
+
+    if (!RxErr) { return; }
+    n = nbits[RxErr & 0x0F] + nbits[RxErr >> 4];
+    RxErr = n;
+    ErrorBits.b[0] += n;
+    if (ErrorBits.b[0] < n) { CARRY32(ErrorBits); }
+#if USE_EARLY
+    if (EarlyOn) { early_err(n); }
+#endif
+}
+
+/* --------------------------------------------------------
+ * rx_los()
+ * - The loss-of-sync window. It is only touched while it holds
+ *   errors, so a clean line pays one test per byte for it.
+ * - A trip sets LosTrip for rx_end() and takes the byte back out of
+ *   CountBytes (before rx_wrap() could carry it): the byte that lost
+ *   sync is not counted.
+ * - USE_HIST: a byte either extends the open burst or the open gap;
+ *   only the first byte after one closes it into a bin.
+ * -------------------------------------------------------- */
+void rx_los() {
+    int n, i;
+
+    n = RxErr;
+    if (n | LosSum) {
+        i = CountBytes.b[0] & (LOS_WIN - 1);
+        LosSum += n - LosWin[i];
+        LosWin[i] = n;
+        if (LosSum > LOS_ERRS) {
+            LosTrip = TRUE;
+            if (CountBytes.b[0]-- == 0) { RxWrap = FALSE; }
+        }
+    }
+#if USE_HIST
+    if (n) {
+        if (GapCnt) { hist_gap(); }
+        BurstBits += n;
+        if (BurstBits < n) { BurstBits = 0xFF; }
+    } else {
+        if (BurstBits) { hist_burst(); }
+        if (++GapCnt == 0) { GapCnt = 0xFFFF; }
+    }
+#endif
+}
+
+/* --------------------------------------------------------
+ * rx_early() / rx_time()
+ * - USE_EARLY: one queued error bit into the bounds (early_step()).
+ *   The POLL_LIVE live screen shares this gap (LIVE_POLL(), BERT.c),
+ *   only on bytes with no queued error bit.
+ * - USE_TIME: the 100ms tick or one sec_step() (TIME_POLL()).
+ * -------------------------------------------------------- */
+void rx_early() {
+#if USE_EARLY
+    if (EarlyPend) { early_step(); }
+#endif
+}
+
+void rx_time() {
+    TIME_POLL();
+}
+
+/* --------------------------------------------------------
+ * rx_wrap()
+ * - Every 256 counted bytes: the upper bytes of CountBytes, LiveDue,
+ *   the stop key / remote stop, and USE_EARLY's PASS test. Stop and
+ *   PASS end the run like the end of the block (rx_end()).
+ * - USE_REP: the byte after a block end finishes it (rep_next()); it
+ *   is the 1st of the next block, never a multiple of 256.
+ * -------------------------------------------------------- */
+void rx_wrap() {
+#if USE_REP
+    if (RepDue) { rep_next(); }
+#endif
+    if (!RxWrap) { return; }
+    RxWrap = FALSE;
+    CARRY32(CountBytes);
+    LiveDue = TRUE;
+
+    // MODE_CONT / MODE_REP stop key or remote stop: end the block right here
+    if (((Mode == MODE_CONT || Mode == MODE_REP) && input(SW_SEL)) || uart_stop()) {
+        TotalBytes = CountBytes.w;
+        TotalLo    = 0;
+#if USE_REP
+        RepEnd     = TRUE;
+#endif
+    }
+#if USE_EARLY
+    // below the limit: PASS (once the queued error bits are in)
+    if (EarlyOn && !EarlyPend && CountBytes.w >= PassAt) {
+        TotalBytes = CountBytes.w;
+        TotalLo    = 0;
+    }
+#endif
+}
+
+/* --------------------------------------------------------
+ * rx_end()
+ * - Last step of a byte: TRUE when TotalBytes have been counted, or
+ *   on loss of sync (LosTrip). The full 32-bit compare only runs when
+ *   the low byte matches (1 in 256 bytes).
+ * - Nothing before the first rx_cmp() of a count phase (RxDue).
+ * - MODE_REP (USE_REP): the end of a block is rep_block() instead, and
+ *   the count goes on; only the stop key ends the run (RepEnd, read
+ *   every 256 bytes and at every block end).
+ * -------------------------------------------------------- */
+short rx_end() {
+    if (!RxDue) { return FALSE; }
+    RxDue = FALSE;
+    if (LosTrip) { return TRUE; }
+
+    if (CountBytes.b[0] != TotalLo) { return FALSE; }
+    if (CountBytes.w != TotalBytes) { return FALSE; }
+#if USE_REP
+    if (Mode == MODE_REP && !RepEnd) { return rep_block(); }
+#endif
+    return TRUE;
+}
+
+/* --------------------------------------------------------
+ * rx_byte()
+ * - All the count phase work of one received byte r at once (the
+ *   loops without gaps to spread it over). The caller loads PnExp
+ *   with the next expected byte afterwards.
+ * - Returns rx_end().
+ * -------------------------------------------------------- */
+short rx_byte(int r) {
+    rx_cmp(r);
+    rx_err();
+    rx_los();
+    rx_wrap();
+    rx_early();
+    rx_time();
+    return rx_end();
+}
+
+/* --------------------------------------------------------
+ * los_reset()
+ * - Empty loss-of-sync window, at the start of every count phase;
+ *   no byte is in the rx_xxx() steps yet.
+ * -------------------------------------------------------- */
+void los_reset() {
+    int i;
+
+    for (i = 0; i < LOS_WIN; i++) { LosWin[i] = 0; }
+    LosSum  = 0;
+    LosTrip = FALSE;
+    RxErr   = 0;
+    RxWrap  = FALSE;
+    RxDue   = FALSE;
+}
+
+/* --------------------------------------------------------
+ * relock()
+ * - Called by pnX_count() when its count loop has ended.
+ * - Loss of sync: SYNC_LED off, the errors of the window are taken
+ *   back out (they are the slip, not the line), and the sync phase is
+ *   entered again from the next byte. Returns TRUE in that case.
+ * - Otherwise the block is done: FALSE.
+ * -------------------------------------------------------- */
+short relock() {
+    if (!LosTrip) { return FALSE; }
+
+    output_low(SYNC_LED);
+
+    // MODE_REP: part of the slip may be in the last block's snapshot
+    if (ErrorBits.w < LosSum) { ErrorBits.w = 0; }
+    else                      { ErrorBits.w -= LosSum; }
+#if USE_EARLY
+    if (EarlyOn) { early_undo(LosSum); }
+#endif
+    if (SyncLoss < 99) { SyncLoss++; }
+    los_reset();
+#if USE_HIST
+    hist_sync(FALSE);                        // the open burst is the slip
+#endif
+
+    SyncLoad     = 0;
+    RenzokuError = 0;
+#if AUTO_POL
+    SyncTry      = 0;
+#endif
+#if USE_TIME
+    Locked       = FALSE;
+    SecLos       = TRUE;
+#endif
+    return TRUE;
+}
+
+/* --------------------------------------------------------
+ * fmt_ber()
+ * - BER = num / (8 * den) bits into BerTxt as "d.ddE-xx", integer only
+ *   (no CCS float library). num = error bits, den = counted bytes.
+ * - den is scaled so that 10 * 8 * den fits in 32 bits, num is brought
+ *   into [8*den, 80*den) by powers of ten (exponent -e), then 4 digits
+ *   come from repeated subtraction (at most 9 per digit, no division)
+ *   and are rounded to 3. Times ten is two shifts and an add: the
+ *   TMR0 live screen runs this between received bytes.
+ * - "0" when there are no errors (or nothing was counted).
+ * - BER <= 1, so the exponent is kept as an unsigned e = -p.
+ * -------------------------------------------------------- */
+char BerTxt[10];
+
+/* --------------------------------------------------------
+ * ber_txt()
+ * - Mantissa m (100..999) and exponent e into BerTxt as "d.ddE-ee"
+ *   ("d.ddE+00" for e = 0), one character at a time. No sprintf():
+ *   the text is always 8 characters, digits by subtraction.
+ * -------------------------------------------------------- */
+void ber_txt(long m, int e) {
+    int d;
+
+    d = 0;
+    while (m >= 100) { m -= 100; d++; }
+    BerTxt[0] = '0' + d;
+    BerTxt[1] = '.';
+    d = 0;
+    while (m >= 10)  { m -= 10; d++; }
+    BerTxt[2] = '0' + d;
+    BerTxt[3] = '0' + (int)m;
+    BerTxt[4] = 'E';
+    BerTxt[5] = '-';
+    if (e == 0) { BerTxt[5] = '+'; }
+    d = 0;
+    while (e >= 10)  { e -= 10; d++; }
+    BerTxt[6] = '0' + d;
+    BerTxt[7] = '0' + e;
+    BerTxt[8] = 0;
+}
+
+void fmt_ber(int32 num, int32 den) {
+    long m;
+    int e, i, d;
+
+    if (num == 0 || den == 0) {
+        strcpy(BerTxt, "0");
+        return;
+    }
+
+    e = 0;
+    while (den > 0x03333333) { den /= 10; e++; }   // > 4E8 bits: drop digits
+    den <<= 3;                                     // bytes -> bits
+
+    while (num / 10 >= den && e) { num /= 10; e--; }
+    while (num < den)            { num = (num << 3) + (num << 1); e++; }
+
+    m = 0;
+    for (i = 0; i < 4; i++) {
+        d = 0;
+        while (num >= den) { num -= den; d++; }
+        m = (m << 3) + (m << 1) + d;
+        num = (num << 3) + (num << 1);
+    }
+
+    m = (m + 5) / 10;                              // 100..1000
+    if (m == 1000) { m = 100; e--; }
+
+    ber_txt(m, e);
+}
+
+/* --------------------------------------------------------
+ * crc16()
+ * - CRC-16/CCITT (x^16 + x^12 + x^5 + 1, MSB first) of one more byte,
+ *   the four-bit-fold form: no table and no bit loop.
+ * -------------------------------------------------------- */
+long crc16(long crc, int b) {
+    int x;
+
+    x  = make8(crc, 1) ^ b;
+    x ^= x >> 4;
+    return (crc << 8) ^ ((long)x << 12) ^ ((long)x << 5) ^ x;
+}
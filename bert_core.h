@@ -0,0 +1,213 @@
+/*
+ * bert_core.h
+ * Measurement state shared by BERT.c, pn_loop.c and bert_core.c (CCS C).
+ *
+ * Only plain C and the CCS types int (8 bit), long (16 bit), short
+ * (1 bit) and int32, so host/ can build the same core with a type shim.
+ * Needs the build options of BERT.c (USE_PNxx, AUTO_POL, LOS_WIN,
+ * USE_HIST, USE_EARLY, USE_WORD, USE_NRZ, USE_REP) before it is included.
+ */
+
+short ClockNeg, DataNeg;     // XOR polarity flags (0/1)
+int   RenzokuError;          // "consecutive match counter" during sync, in bits (JP: A)
+int   ThresError;            // required consecutive matches to declare lock
+int   SyncLoad;              // bits seeded into PnHist since the last (re)load
+
+/*
+ * Measurement counters, 32-bit.
+ * Bits are counted per received byte, so CountBytes * 8 reaches 3.4E10
+ * bits and 1E10-bit runs (BER down to 1E-10) fit.
+ * The union gives byte access for carry-only increments: the low byte is
+ * bumped and the upper bytes are touched once every 256 steps (CARRY32).
+ */
+typedef union {
+    int32 w;
+    int   b[4];
+} cnt32;
+
+cnt32 ErrorBits;             // number of bit errors during counting phase
+cnt32 CountBytes;            // actual counted bytes (8 bits each)
+int32 TotalBytes;            // bytes to count during measurement (from table)
+int   TotalLo;               // low byte of TotalBytes (cheap "maybe done" test)
+
+#define CARRY32(c)  if (++c.b[1] == 0) { if (++c.b[2] == 0) { ++c.b[3]; } }
+
+/*
+ * PN polynomials (ITU-T O.150 shift registers, x^N + x^K + 1).
+ * Poly selects one at run time (menu + EEPROM); each compiled-in
+ * polynomial has its own constant-tap engine from pn_loop.c.
+ * O.150 sends PN15 and PN23 inverted, pn_inv[] folds that into DataMask.
+ */
+#define POLY_PN7    0
+#define POLY_PN9    1
+#define POLY_PN11   2
+#define POLY_PN15   3
+#define POLY_PN23   4
+#define POLY_WORD   5        // learned repeating word (USE_WORD), not a PN
+#define POLY_COUNT  6
+
+int   Poly;                  // selected polynomial (POLY_xxx)
+int const pn_deg[POLY_COUNT] = {7, 9, 11, 15, 23, 0};
+int const pn_on[POLY_COUNT]  = {USE_PN7, TRUE, USE_PN11, USE_PN15, USE_PN23, USE_WORD};
+int const pn_inv[POLY_COUNT] = {0, 0, 0, 1, 1, 0};
+// crc16() of pnX_test(), checked by self_test() at power-on
+long const pn_crc[POLY_COUNT] = {0x6A6A, 0xF6C0, 0x45AE, 0x215B, 0x2B51, 0};
+
+/*
+ * LFSR state (packed).
+ * The expected sequence used to be a short tap[16] bit array advanced with
+ * shift_right(tap, 2, tap[7] ^ tap[11]) on every received bit.
+ * It is now a plain history, newest bit in bit 0
+ * (bit j = the bit received/expected j+1 clocks ago), e.g.
+ *
+ *   PN9 (x^9 + x^5 + 1):  b(n) = b(n-9) ^ b(n-5) = PnHist.8 ^ PnHist.4
+ *
+ * which is the same sequence as the old tap[7] ^ tap[11] feedback.
+ *
+ * - Sync phase : one bit at a time, the engine predicts the next bit.
+ * - Count phase: pnX_next() makes the next 8 expected bits at once, so the
+ *                LFSR work is done once per 8 clocks and the per-bit path
+ *                only shifts DATA_IN into RxByte.
+ */
+#if USE_PN23
+int32 PnHist = 0xFFFFFFFF;
+#else
+long  PnHist = 0xFFFF;
+#endif
+#if AUTO_POL
+#if USE_PN23
+int32 PnSeed;                // first VERIFY byte: the other polarity's register
+#else
+long  PnSeed;
+#endif
+int   SyncTry;               // sync bytes since the last clock edge change
+int   SyncAlt;               // first VERIFY byte from the inverted seed
+#endif
+int   PnExp;                 // expected bits of the current byte (oldest = bit 7)
+int   DataMask;              // DataNeg ^ pn_inv[Poly] as a byte-wide XOR mask
+int   RxByte;                // received bits, shifted in at bit 0
+int   RxLeft;                // bits left until RxByte is complete
+
+#if USE_WORD
+/*
+ * Learned word (POLY_WORD: pn_loop.c built with PN_WORD).
+ * A pattern that repeats every WordP bits follows b(n) = b(n-WordP),
+ * so the expected bits are the expected bits of WordP clocks ago.
+ * WordRing[] keeps the last WORD_RING expected bytes (WordPos = the
+ * newest); the next byte is two ring reads and a shift by WordR (one
+ * read when WordP is a multiple of 8), no LFSR work at all.
+ * Learning: the sync phase tries WordP = WORD_MIN..WORD_MAX in turn;
+ * a candidate only locks after ThresError + WORD_MAX matching bits,
+ * so the first one that does is the shortest period >= WORD_MIN of
+ * the line (a period below 8 locks as its first multiple >= 8).
+ */
+#define WORD_MIN    8
+#define WORD_MAX    64
+#define WORD_RING   16       // bytes, power of 2, >= WORD_MAX / 8 + 2
+#define WORD_MASK   (WORD_RING - 1)
+
+int   WordRing[WORD_RING];
+int   WordPos;               // newest byte in WordRing[]
+int   WordP;                 // period (candidate while learning), bits
+int   WordQ;                 // WordP / 8
+int   WordR;                 // WordP % 8
+int   WordLen;               // period of the last lock, 0 = none
+#endif
+
+/* Loss-of-sync window (rx_los(), relock()) */
+int   LosWin[LOS_WIN];       // error bits per byte, indexed by CountBytes
+int   LosSum;                // sum of LosWin[]
+short LosTrip;               // rx_end() stopped the count loop on LOS
+int   SyncLoss;              // re-locks in this run (saturates at 99)
+
+/* The byte in the rx_xxx() steps (bert_core.c, rx_cmp() .. rx_end()) */
+int   RxErr;                 // its error mask, error bits after rx_err()
+short RxWrap;                // it took CountBytes to a multiple of 256
+short RxDue;                 // rx_end() has not seen it yet
+
+#if USE_EARLY
+/*
+ * Early termination against a BER limit L (early_init(), rx_byte()).
+ * Per = 1/(8L), the bytes per error at the limit. The run ends early:
+ *   FAIL : EARLY_ERRS errors, or EARLY_MIN with CountBytes < FailAt,
+ *          i.e. a BER above 2L (16 errors where 8 were expected at L).
+ *          early_verdict() reports either as FAIL (EarlyFail), also
+ *          an EARLY_ERRS end with a BER below L
+ *   PASS : CountBytes >= PassAt = (3 + 1.75 E) Per, the 95% upper
+ *          bound (3 / L bits with no error) with a margin per error
+ * Both bounds grow by a 32-bit add per error bit and saturate at
+ * 0xFFFFFFFF. The adds are queued in EarlyPend and done one bit per
+ * byte (early_step()), so an error byte never pays for eight of them;
+ * PASS waits until the queue is empty. The clean-byte path pays one
+ * test per byte and one compare every 256 bytes.
+ */
+#define EARLY_ERRS  100
+#define EARLY_MIN   16
+
+#define EARLY_PASS  0        // early_verdict()
+#define EARLY_FAIL  1
+#define EARLY_OPEN  2        // neither: too few bits for the limit
+
+short EarlyOn;
+int32 FailStep;              // Per / 2
+int32 PassStep;              // Per * 1.75
+int32 FailAt;                // E * FailStep
+int32 PassAt;                // 3 Per + E * PassStep
+long  EarlyPend;             // error bits not in the bounds yet
+short EarlyClean;            // LOS window clean before the last error byte
+short EarlyFail;             // early_step() ended the run (FAIL)
+#endif
+
+#if USE_REP
+/*
+ * Back-to-back blocks (MODE_REP, rep_block()).
+ * At the end of every block the counters move into the snapshot and
+ * the count phase carries on with the next byte: no settle delay, no
+ * sync, no bit of the line left out. RepEnd (stop key) ends the run.
+ */
+int32 SnapErr;               // ErrorBits of the last full block
+int   SnapLoss;              // its SyncLoss
+long  SnapSeq;               // full blocks so far
+short SnapDue;               // new snapshot for the live screen
+short RepEnd;                // stop key / remote stop seen
+short RepDue;                // rep_block() done, rep_next() not yet
+#endif
+
+#if USE_NRZ
+/*
+ * Clock recovery (MODE_NRZ: nrz_sample(), fed by nrz_bit() of BERT.c).
+ * DATA_IN is sampled NRZ_OVS times per nominal bit; NrzPh numbers the
+ * samples of the current bit, 0 = the first one after a transition.
+ */
+#define NRZ_OVS     4        // samples per bit, power of 2
+#define NRZ_MID     2        // the sample that is the bit
+#define NRZ_NONE    2        // nrz_sample(): no bit this time
+
+int   NrzPh;
+short NrzLast;               // DATA_IN at the last sample
+#endif
+
+/* Number of 1 bits in a nibble (error bits per compared byte) */
+int const nbits[16] = {0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4};
+
+#if USE_HIST
+/*
+ * Error structure, in whole bytes so the count phase cost stays fixed:
+ *   burst : bytes with errors back to back; size = error bits in it
+ *   gap   : clean bytes between two bursts
+ * Bin k counts sizes 2^k .. 2^(k+1)-1 (the last bin: and above),
+ * i.e. bursts of 1, 2-3, 4-7 ... bits and gaps of 8, 16-31 ... bits.
+ * Counts saturate at 65535.
+ */
+#define BURST_BINS  8
+#define GAP_BINS    12
+
+long  BurstHist[BURST_BINS];
+long  GapHist[GAP_BINS];
+int   BurstBits;             // error bits of the open burst (saturates)
+long  GapCnt;                // clean bytes since the last burst (saturates)
+short HistOn;                // a burst has ended: GapCnt is a real gap
+
+/* floor(log2(n)) of a nibble, n = 0 gives 0 */
+int const lg4[16] = {0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3};
+#endif
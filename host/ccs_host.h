@@ -0,0 +1,103 @@
+/*
+ * ccs_host.h
+ * Just enough of CCS C to build bert_core.c, pn_loop.c, lcd_fb.c and
+ * live.c with a host compiler (host/core_host.c only), pn_loop.c for
+ * both engines.
+ *
+ * CCS types are narrower than the host ones:
+ *   int = 8 bit, long = 16 bit, short = 1 bit (used as 0/1 here)
+ * so they are macros from here on. Include this last of the system
+ * headers, and keep host code that needs the real int out of this
+ * translation unit (sim.c talks to it through core_api.h).
+ */
+#ifndef CCS_HOST_H
+#define CCS_HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define int32  uint32_t
+#define int    uint8_t
+#define long   uint16_t
+#define short  uint8_t
+
+#define TRUE   1
+#define FALSE  0
+
+#define make8(x, n)  ((uint8_t)((x) >> ((n) * 8)))
+
+/* printf(fb_putc, "text") of live_init(): plain text, no format */
+#define printf(out, s)  ccs_printf(out, s)
+
+static inline void ccs_printf(void (*out)(char), const char *s) {
+    while (*s) { out(*s++); }
+}
+
+/* lcd_fb.c: the frame buffer is the screen, nothing is sent */
+#define lcd_gotoxy(x, y)
+#define lcd_putc(c)
+
+/* Pins: the core drives SYNC_LED and looks at SW_SEL (HostSel,
+ * core_sel_set()); the ENGINE_POLL loops read CLK_IN / DATA_IN from
+ * host_clk() / host_data() */
+#define SYNC_LED       0
+#define SW_SEL         1
+#define CLK_IN         2
+#define DATA_IN        3
+#define input(pin)     ((pin) == SW_SEL ? HostSel : \
+                        (pin) == CLK_IN ? host_clk() : host_data())
+#define output_low(pin)
+#define output_high(pin)
+
+/* shift_left(&RxByte, 1, b): the one form pn_loop.c uses */
+#define shift_left(p, n, b)  (*(p) = (uint8_t)((*(p) << 1) | (b)))
+
+/* Build options of BERT.c, as the host build uses them */
+#define ENGINE_POLL  0
+#define ENGINE_TMR0  1
+#define BERT_ENGINE  ENGINE_TMR0     // pnX_count() takes bytes from rx_get();
+                                     // core_host.c adds poll_pnX_count()
+
+#define USE_PN7      TRUE
+#define USE_PN11     TRUE
+#define USE_PN15     TRUE
+#define USE_PN23     TRUE
+#define AUTO_POL     TRUE
+#define LOS_WIN      8
+#define LOS_ERRS     16
+#define USE_HIST     TRUE
+#define USE_TIME     FALSE
+#define USE_EARLY    TRUE
+#define USE_WORD     TRUE
+#define USE_NRZ      TRUE
+#define USE_REP      TRUE
+#define POLL_LIVE    TRUE            // cont_step() of live.c
+
+#define USE_CAP      FALSE
+#define USE_GEN      FALSE
+#define USE_LANE     FALSE
+#define USE_ASM      FALSE           // ENGINE_POLL: the C bit loops
+
+#define TIME_POLL()
+#define uart_stop()   FALSE
+#define INJ_BYTE(x)
+#define LIVE_POLL()
+#define OVR_MARK()
+#define OVR_CHECK()
+#define PROF_START()
+#define PROF_END()
+
+extern uint8_t HostSel;
+
+/* ENGINE_POLL pins, core_host.c: CLK_IN toggles on every read, DATA_IN
+ * is the next bit of rx_get(), oldest first */
+uint8_t host_clk(void);
+uint8_t host_data(void);
+
+/* BERT.c side, provided by sim.c */
+uint8_t rx_get(void);
+void    on_lock(void);
+void    clock_flip(void);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * core_api.h
+ * Host interface to the firmware core built by core_host.c.
+ * Plain host types: the CCS type macros stay inside core_host.c.
+ */
+#ifndef CORE_API_H
+#define CORE_API_H
+
+#include <stdint.h>
+
+#define CORE_POLYS  5                /* POLY_PN7 .. POLY_PN23 */
+#define CORE_PN23   4
+#define CORE_WORD   5                /* POLY_WORD, not in core_deg[] etc. */
+
+typedef struct {
+    uint32_t errors;                 /* ErrorBits */
+    uint32_t bytes;                  /* CountBytes */
+    uint8_t  sync_loss;              /* SyncLoss */
+    uint8_t  data_neg;               /* DataMask != 0 after the run */
+    uint8_t  clock_neg;              /* ClockNeg after the run */
+    uint16_t burst[8];               /* BurstHist[] */
+    uint16_t gap[12];                /* GapHist[] */
+    uint32_t pass_at;                /* PassAt (USE_EARLY) */
+    uint8_t  word_len;               /* WordLen (USE_WORD) */
+    uint32_t snap_err;               /* SnapErr (USE_REP) */
+    uint8_t  snap_loss;              /* SnapLoss */
+    uint16_t snap_seq;               /* SnapSeq */
+} core_result;
+
+extern const uint8_t core_deg[CORE_POLYS];
+extern const uint8_t core_tap[CORE_POLYS];
+extern const uint8_t core_inv[CORE_POLYS];
+
+/* countber() set-up, then pnX_count() for poly; total_bytes 0 = no end */
+void core_run(uint8_t poly, uint32_t total_bytes, uint8_t thres,
+              uint8_t data_neg, uint8_t clock_neg);
+void core_result_get(core_result *r);
+
+/* early_init() argument for the next core_run()s: bytes per error at
+ * the BER limit, 0 = off */
+void core_early_set(uint32_t per);
+/* MODE_REP instead of MODE_BLOCK for the next core_run()s: total_bytes
+ * is the block, the run goes on until aborted (MaxBytes) */
+void core_rep_set(uint8_t on);
+/* early_verdict(per) after a run: CORE_PASS / CORE_FAIL / CORE_OPEN */
+#define CORE_PASS  0                 /* EARLY_PASS */
+#define CORE_FAIL  1                 /* EARLY_FAIL */
+#define CORE_OPEN  2                 /* EARLY_OPEN */
+uint8_t core_early_verdict(uint32_t per);
+/* pnX_count() of the next core_run()s: the ENGINE_TMR0 build (one
+ * rx_get() byte per step), the ENGINE_POLL C loops (PN_FN(lock)(), one
+ * count step per bit gap) with DATA_IN bits of rx_get() on a toggling
+ * CLK_IN, or their MODE_NRZ loop (one DATA_IN bit per nrz_bit()) */
+#define CORE_TMR0  0
+#define CORE_POLL  1
+#define CORE_NRZ   2
+void core_engine_set(uint8_t e);
+/* SW_SEL as the core reads it with input() */
+void core_sel_set(uint8_t down);
+uint8_t core_clock_neg(void);
+void core_clock_neg_set(uint8_t v);
+
+/* nrz_sample() of MODE_NRZ: bit phase reset with DATA_IN = s, then one
+ * sample per call; the bit, or CORE_NRZ_NONE */
+#define CORE_NRZ_NONE  2             /* NRZ_NONE */
+void core_nrz_reset(uint8_t s);
+uint8_t core_nrz_sample(uint8_t s, uint8_t late);
+
+/* pnX_test() of poly, and its pn_crc[] */
+uint16_t core_pn_test(uint8_t poly);
+uint16_t core_pn_crc(uint8_t poly);
+
+/* fmt_ber() into out[10] */
+void core_fmt_ber(uint32_t num, uint32_t den, char *out);
+
+/* live.c: live_init() of MODE_CONT (rep 0) or MODE_REP (rep 1) on an
+ * empty frame buffer */
+void core_live_init(uint8_t rep);
+/* cont_step() until one update of the counters is on the screen; out[34]
+ * gets LcdFb[] as two lines, the result is the number of steps */
+uint16_t core_cont_live(uint32_t errors, uint32_t bytes, char *out);
+/* rep_step() until one snapshot (block seq of 10^(tbi+3) bits with
+ * errors and loss re-locks) is on the screen, as core_cont_live() */
+uint16_t core_rep_live(uint32_t errors, uint16_t seq, uint8_t loss,
+                       uint8_t tbi, char *out);
+/* div10() of live.c */
+uint32_t core_div10(uint32_t n);
+
+#endif
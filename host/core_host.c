@@ -0,0 +1,309 @@
+/*
+ * core_host.c
+ * The firmware core, unchanged, for the host: bert_core.h/.c, one
+ * pn_loop.c per polynomial, lcd_fb.c and live.c, included the way
+ * BERT.c includes them. pn_loop.c goes in twice: pnX_xxx() as the
+ * ENGINE_TMR0 build (bytes from rx_get()), poll_pnX_xxx() as the
+ * ENGINE_POLL one (bits from host_data(), core_engine_set()).
+ * core_run() repeats the set-up part of countber() that concerns the
+ * core; keep the two in step.
+ */
+#include "core_api.h"
+#include "ccs_host.h"
+
+/* BERT.c globals the core refers to */
+#define MODE_BLOCK  0
+#define MODE_CONT   1
+#define MODE_NRZ    6
+#define MODE_REP    7
+
+int   Mode;
+short LiveDue;
+int   LiveStep;
+int32 LiveNum;
+int32 LiveDen;
+long  LiveM;
+int   LiveE;
+int   RepTbi;
+long  RepSeq;
+int   RepLoss;
+uint8_t HostSel;                     /* SW_SEL, core_sel_set() */
+
+static uint32_t EarlyPer;            /* core_early_set() */
+static uint8_t  RepOn;               /* core_rep_set() */
+static uint8_t  Engine;              /* core_engine_set() */
+static uint8_t  HostClk;             /* CLK_IN level */
+static uint8_t  HostByte;            /* rx_get() byte on DATA_IN */
+static uint8_t  HostLeft;            /* its bits still to come */
+
+#include "../lcd_fb.c"
+#include "../bert_core.h"
+#include "../bert_core.c"
+#include "../live.c"
+
+#define PN_N      9
+#define PN_K      5
+#define PN_FN(f)  pn9_##f
+#include "../pn_loop.c"
+
+#define PN_N      7
+#define PN_K      6
+#define PN_FN(f)  pn7_##f
+#include "../pn_loop.c"
+
+#define PN_N      11
+#define PN_K      9
+#define PN_FN(f)  pn11_##f
+#include "../pn_loop.c"
+
+#define PN_N      15
+#define PN_K      14
+#define PN_FN(f)  pn15_##f
+#include "../pn_loop.c"
+
+#define PN_N      23
+#define PN_K      18
+#define PN_FN(f)  pn23_##f
+#include "../pn_loop.c"
+
+#define PN_WORD
+#define PN_FN(f)  word_##f
+#include "../pn_loop.c"
+
+/* ENGINE_POLL pins: every CLK_IN read is the other level, so each
+ * edge wait of pn_loop.c sees its edge within two reads */
+uint8_t host_clk(void) {
+    HostClk = !HostClk;
+    return HostClk;
+}
+
+uint8_t host_data(void) {
+    if (HostLeft == 0) {
+        HostByte = rx_get();
+        HostLeft = 8;
+    }
+    HostLeft--;
+    return (HostByte >> HostLeft) & 1;
+}
+
+/* nrz_bit() of BERT.c with the clock recovered already: one DATA_IN
+ * bit per call (case_nrz covers nrz_sample()) */
+short nrz_bit() {
+    return input(DATA_IN);
+}
+
+#undef  BERT_ENGINE
+#define BERT_ENGINE  ENGINE_POLL
+
+#define PN_N      9
+#define PN_K      5
+#define PN_FN(f)  poll_pn9_##f
+#include "../pn_loop.c"
+
+#define PN_N      7
+#define PN_K      6
+#define PN_FN(f)  poll_pn7_##f
+#include "../pn_loop.c"
+
+#define PN_N      11
+#define PN_K      9
+#define PN_FN(f)  poll_pn11_##f
+#include "../pn_loop.c"
+
+#define PN_N      15
+#define PN_K      14
+#define PN_FN(f)  poll_pn15_##f
+#include "../pn_loop.c"
+
+#define PN_N      23
+#define PN_K      18
+#define PN_FN(f)  poll_pn23_##f
+#include "../pn_loop.c"
+
+#define PN_WORD
+#define PN_FN(f)  poll_word_##f
+#include "../pn_loop.c"
+
+const uint8_t core_deg[CORE_POLYS] = {7, 9, 11, 15, 23};
+const uint8_t core_tap[CORE_POLYS] = {6, 5, 9, 14, 18};
+const uint8_t core_inv[CORE_POLYS] = {0, 0, 0, 1, 1};
+
+void core_run(uint8_t poly, uint32_t total_bytes, uint8_t thres,
+              uint8_t data_neg, uint8_t clock_neg) {
+    Poly       = poly;
+    Mode       = RepOn ? MODE_REP : MODE_BLOCK;
+    if (Engine == CORE_NRZ) { Mode = MODE_NRZ; }
+    ThresError = thres;
+    DataNeg    = data_neg;
+    ClockNeg   = clock_neg;
+
+    /* countber() */
+    RenzokuError = 0;
+    ErrorBits.w  = 0;
+    CountBytes.w = 0;
+    TotalBytes   = total_bytes;
+    TotalLo      = make8(TotalBytes, 0);
+    SyncLoad     = 0;
+    SyncTry      = 0;
+    SyncLoss     = 0;
+    if (Poly == POLY_WORD) {
+        word_period(0);
+        WordLen = 0;
+    }
+    los_reset();
+    hist_sync(TRUE);
+    early_init(RepOn ? 0 : EarlyPer);
+    SnapSeq = 0;
+    SnapDue = FALSE;
+    RepEnd  = FALSE;
+    RepDue  = FALSE;
+
+    DataMask = 0;
+    if (DataNeg ^ pn_inv[Poly]) { DataMask = 0xFF; }
+    RxLeft = 8;
+    HostLeft = 0;
+
+    if (Engine == CORE_TMR0) {
+        switch (Poly) {
+            case POLY_PN7:  pn7_count();  break;
+            case POLY_PN11: pn11_count(); break;
+            case POLY_PN15: pn15_count(); break;
+            case POLY_PN23: pn23_count(); break;
+            case POLY_WORD: word_count(); break;
+            default:        pn9_count();  break;
+        }
+    } else {
+        switch (Poly) {
+            case POLY_PN7:  poll_pn7_count();  break;
+            case POLY_PN11: poll_pn11_count(); break;
+            case POLY_PN15: poll_pn15_count(); break;
+            case POLY_PN23: poll_pn23_count(); break;
+            case POLY_WORD: poll_word_count(); break;
+            default:        poll_pn9_count();  break;
+        }
+    }
+
+    if (BurstBits) { hist_burst(); }
+}
+
+void core_result_get(core_result *r) {
+    uint8_t i;
+
+    r->errors    = ErrorBits.w;
+    r->bytes     = CountBytes.w;
+    r->sync_loss = SyncLoss;
+    r->data_neg  = (DataMask != 0) ^ pn_inv[Poly];
+    r->clock_neg = ClockNeg;
+    for (i = 0; i < BURST_BINS; i++) { r->burst[i] = BurstHist[i]; }
+    for (i = 0; i < GAP_BINS; i++)   { r->gap[i] = GapHist[i]; }
+    r->pass_at   = PassAt;
+    r->word_len  = WordLen;
+    r->snap_err  = SnapErr;
+    r->snap_loss = SnapLoss;
+    r->snap_seq  = SnapSeq;
+}
+
+void core_early_set(uint32_t per) {
+    EarlyPer = per;
+}
+
+uint8_t core_early_verdict(uint32_t per) {
+    return early_verdict(per);
+}
+
+void core_rep_set(uint8_t on) {
+    RepOn = on;
+}
+
+void core_engine_set(uint8_t e) {
+    Engine = e;
+}
+
+void core_sel_set(uint8_t down) {
+    HostSel = down;
+}
+
+uint8_t core_clock_neg(void) {
+    return ClockNeg;
+}
+
+void core_clock_neg_set(uint8_t v) {
+    ClockNeg = v;
+}
+
+void core_nrz_reset(uint8_t s) {
+    NrzPh   = 0;
+    NrzLast = s;
+}
+
+uint8_t core_nrz_sample(uint8_t s, uint8_t late) {
+    return nrz_sample(s, late);
+}
+
+uint16_t core_pn_test(uint8_t poly) {
+    switch (poly) {
+        case POLY_PN7:  return pn7_test();
+        case POLY_PN11: return pn11_test();
+        case POLY_PN15: return pn15_test();
+        case POLY_PN23: return pn23_test();
+        default:        return pn9_test();
+    }
+}
+
+uint16_t core_pn_crc(uint8_t poly) {
+    return pn_crc[poly];
+}
+
+void core_fmt_ber(uint32_t num, uint32_t den, char *out) {
+    fmt_ber(num, den);
+    strcpy(out, BerTxt);
+}
+
+/* LcdFb[] as two 16-character lines */
+static void live_text(char *out) {
+    memcpy(out, LcdFb, 16);
+    out[16] = '\n';
+    memcpy(out + 17, LcdFb + 16, 16);
+    out[33] = 0;
+}
+
+void core_live_init(uint8_t rep) {
+    fb_init();
+    Mode = rep ? MODE_REP : MODE_CONT;
+    live_init();
+}
+
+uint16_t core_rep_live(uint32_t errors, uint16_t seq, uint8_t loss,
+                       uint8_t tbi, char *out) {
+    uint16_t n = 0;
+
+    SnapErr  = errors;
+    SnapSeq  = seq;
+    SnapLoss = loss;
+    SnapDue  = TRUE;
+    RepTbi   = tbi;
+    do {
+        rep_step();
+        n++;
+    } while (LiveStep != 0);
+    live_text(out);
+    return n;
+}
+
+uint32_t core_div10(uint32_t n) {
+    return div10(n);
+}
+
+uint16_t core_cont_live(uint32_t errors, uint32_t bytes, char *out) {
+    uint16_t n = 0;
+
+    ErrorBits.w  = errors;
+    CountBytes.w = bytes;
+    LiveDue = TRUE;
+    do {
+        cont_step();
+        n++;
+    } while (LiveStep != 0);
+    live_text(out);
+    return n;
+}
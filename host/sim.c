@@ -0,0 +1,876 @@
+/*
+ * sim.c
+ * Host regression and benchmark harness for the BERT core.
+ *
+ * The firmware core (bert_core.c + pn_loop.c, see core_host.c) runs as
+ * the ENGINE_TMR0 build does: one received byte per rx_get(), packed
+ * oldest bit first as clk_isr() packs them. The bytes come from a
+ * synthetic line made by an independent bit-serial LFSR:
+ *
+ *   clean   every polynomial, both data polarities, random bit phase
+ *   ber     random bit errors at a fixed rate after lock
+ *   burst   k error bits every n bytes (histogram bins)
+ *   slip    one bit dropped from the line (loss of sync, re-lock)
+ *   edge    the first clock edge tried is the wrong one (AUTO_POL)
+ *   early   BER limit: FAIL / PASS end the run early (USE_EARLY)
+ *   word    repeating words of 3..64 bits, period learned (USE_WORD)
+ *   nrz     clock recovery from edge times with jitter (USE_NRZ)
+ *   rep     back-to-back blocks, the snapshot of each (USE_REP), and
+ *           the SW_SEL stop with blocks shorter than 256 bytes
+ *   engine  the ENGINE_POLL lock / count loops and their MODE_NRZ loop
+ *           (one step per bit gap) against the above on the same line
+ *   selftest  pnX_test() and pn_crc[] against the reference LFSR
+ *   fmt     fmt_ber() against double precision
+ *   live    the ENGINE_POLL Continuous and Repeat screens
+ *           (cont_step(), rep_step(): no division) against fmt_ber()
+ *           and printf()
+ *
+ * Usage:  bertsim [check]   run the cases, exit 1 on any failure
+ *         bertsim bench     host time per bit of the count phase
+ *
+ * The counts are exact: the harness knows every bit it flipped after
+ * the lock, so "measured == injected" is the test, not a tolerance.
+ * Cycle counts on the PIC are not modelled here; they are documented at
+ * the #asm loops of BERT.c.
+ */
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core_api.h"
+
+/* -------- synthetic line -------- */
+
+typedef struct {
+    int      poly;
+    uint32_t hist;                   /* reference LFSR, newest bit in bit 0 */
+    int      inv;                    /* line inverted (DataNeg of the source) */
+    int      edge;                   /* clock edge the data is valid on */
+    double   ber;                    /* random errors after lock */
+    long     burst_every;            /* bytes per burst period, 0 = none */
+    int      burst_bits;             /* error bits per burst (1..8) */
+    long     slip_at;                /* byte after lock with a dropped bit */
+    const uint8_t *replay;           /* bench: pre-made line */
+    uint64_t word;                   /* CORE_WORD: the pattern, MSB first */
+    int      wlen;                   /* its length in bits */
+    int      wpos;                   /* next bit of it */
+} line_cfg;
+
+static line_cfg Line;
+static long     LineBytes;           /* bytes handed to the core */
+static long     LockAt;              /* LineBytes at the first lock, -1 = none */
+static long     AfterLock;           /* bytes since the first lock */
+static long     Injected;            /* bits flipped after the first lock */
+static long     MaxBytes;            /* give up (no lock) after this many */
+static long     RepBlock;            /* MODE_REP: bytes per block, 0 = off */
+static long     RepInj[16];          /* Injected at the end of each block */
+static int      RepN;
+static long     SelAt;               /* SW_SEL down after this many, 0 = never */
+static jmp_buf  Abort;
+static uint32_t Rng = 1;
+
+static uint32_t rnd(void) {
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+    return Rng;
+}
+
+static int ref_bit(void) {
+    int n, k, b;
+
+    if (Line.wlen) {
+        b = (int)(Line.word >> (Line.wlen - 1 - Line.wpos)) & 1;
+        Line.wpos = (Line.wpos + 1) % Line.wlen;
+        return b ^ Line.inv;
+    }
+
+    n = core_deg[Line.poly];
+    k = core_tap[Line.poly];
+    b = ((Line.hist >> (n - 1)) ^ (Line.hist >> (k - 1))) & 1;
+    Line.hist = (Line.hist << 1) | b;
+    return b ^ core_inv[Line.poly] ^ Line.inv;
+}
+
+static uint8_t line_byte(void) {
+    uint8_t r = 0;
+    int i;
+
+    for (i = 0; i < 8; i++) { r = (uint8_t)((r << 1) | ref_bit()); }
+    return r;
+}
+
+static int popcount8(uint8_t x) {
+    int n = 0;
+
+    while (x) { n += x & 1; x >>= 1; }
+    return n;
+}
+
+/* BERT.c side of the core: clk_isr() / rx_get() */
+uint8_t rx_get(void) {
+    uint8_t r, e;
+    int i;
+
+    if (LineBytes++ >= MaxBytes) { longjmp(Abort, 1); }
+
+    if (Line.replay) { return Line.replay[LineBytes - 1]; }
+
+    if (LockAt >= 0 && Line.slip_at && AfterLock == Line.slip_at) {
+        ref_bit();                   /* this bit never reaches the tester */
+    }
+    r = line_byte();
+
+    if (core_clock_neg() != Line.edge) {
+        return (uint8_t)rnd();       /* sampled in the data transitions */
+    }
+    if (LockAt < 0) { return r; }
+
+    e = 0;
+    if (Line.ber > 0) {
+        for (i = 0; i < 8; i++) {
+            if (rnd() < Line.ber * 4294967296.0) { e |= (uint8_t)(1 << i); }
+        }
+    }
+    if (Line.burst_every && AfterLock % Line.burst_every == Line.burst_every - 1) {
+        e |= (uint8_t)((1 << Line.burst_bits) - 1);
+    }
+    AfterLock++;
+    Injected += popcount8(e);
+    if (RepBlock && AfterLock % RepBlock == 0 && RepN < 16) {
+        RepInj[RepN++] = Injected;
+    }
+    if (SelAt && AfterLock == SelAt) { core_sel_set(1); }
+    return r ^ e;
+}
+
+void on_lock(void) {
+    if (LockAt < 0) { LockAt = LineBytes; }
+}
+
+void clock_flip(void) {
+    core_clock_neg_set(!core_clock_neg());
+}
+
+/* -------- cases -------- */
+
+static int Fails;
+static int Cases;
+
+static void line_init(int poly) {
+    int i;
+
+    memset(&Line, 0, sizeof Line);
+    Line.poly = poly;
+    Line.hist = 0xFFFFFFFF;
+    for (i = rnd() % 997; i > 0; i--) { ref_bit(); }   /* random phase */
+}
+
+static void word_init(uint64_t word, int wlen) {
+    int i;
+
+    memset(&Line, 0, sizeof Line);
+    Line.poly = CORE_WORD;
+    Line.word = word;
+    Line.wlen = wlen;
+    for (i = rnd() % 997; i > 0; i--) { ref_bit(); }   /* random phase */
+}
+
+/* One core run on Line; 0 = no lock within max_bytes */
+static int run(core_result *r, uint32_t total, int thres, int data_neg,
+               int clock_neg, long max_bytes) {
+    LineBytes = 0;
+    LockAt    = -1;
+    AfterLock = 0;
+    Injected  = 0;
+    MaxBytes  = max_bytes;
+    core_sel_set(0);
+
+    if (setjmp(Abort)) { return 0; }
+    core_run((uint8_t)Line.poly, total, (uint8_t)thres,
+             (uint8_t)data_neg, (uint8_t)clock_neg);
+    core_result_get(r);
+    return 1;
+}
+
+static void expect(int ok, const char *name, const char *fmt, ...) {
+    va_list ap;
+
+    Cases++;
+    if (!ok) { Fails++; }
+    printf("%-4s %-24s ", ok ? "ok" : "FAIL", name);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+static void case_clean(void) {
+    core_result r;
+    char name[32];
+    int p, inv, thres, lock;
+
+    for (p = 0; p < CORE_POLYS; p++) {
+        for (inv = 0; inv < 2; inv++) {
+            for (thres = 8; thres <= 32; thres += 11) {
+                line_init(p);
+                Line.inv = inv;
+                snprintf(name, sizeof name, "clean PN%d inv%d T%d",
+                         core_deg[p], inv, thres);
+                lock = (core_deg[p] + 7) / 8 + (thres + 7) / 8;
+                if (!run(&r, 125000, thres, 0, 0, 200000)) {
+                    expect(0, name, "no lock");
+                    continue;
+                }
+                expect(r.errors == 0 && r.bytes == 125000 && r.sync_loss == 0 &&
+                       LockAt == lock && r.data_neg == inv,
+                       name, "E=%lu lock=%ld bytes (expect %d) D%u",
+                       (unsigned long)r.errors, LockAt, lock, r.data_neg);
+            }
+        }
+    }
+}
+
+static void case_ber(void) {
+    static const double rates[] = {1e-2, 1e-3, 1e-4, 1e-5};
+    core_result r;
+    char name[32], ber[10];
+    int p, i;
+
+    for (p = 0; p < CORE_POLYS; p++) {
+        for (i = 0; i < 4; i++) {
+            line_init(p);
+            Line.ber = rates[i];
+            snprintf(name, sizeof name, "ber PN%d %.0e", core_deg[p], rates[i]);
+            if (!run(&r, 1250000, 10, 0, 0, 2000000)) {
+                expect(0, name, "no lock");
+                continue;
+            }
+            core_fmt_ber(r.errors, r.bytes, ber);
+            expect(r.errors == (uint32_t)Injected && r.sync_loss == 0, name,
+                   "E=%lu injected=%ld BER=%s", (unsigned long)r.errors,
+                   Injected, ber);
+        }
+    }
+}
+
+static int log2i(long v) {
+    int n = 0;
+
+    while (v > 1) { v >>= 1; n++; }
+    return n;
+}
+
+static void case_burst(void) {
+    static const int bits[] = {1, 3, 8};
+    static const long every[] = {9, 100, 3000};
+    core_result r;
+    char name[32];
+    long bursts;
+    int i, bb, gb;
+
+    for (i = 0; i < 3; i++) {
+        line_init(CORE_PN23);
+        Line.burst_bits  = bits[i];
+        Line.burst_every = every[i];
+        snprintf(name, sizeof name, "burst %dbit/%ldB", bits[i], every[i]);
+        if (!run(&r, 300000, 10, 0, 0, 400000)) {
+            expect(0, name, "no lock");
+            continue;
+        }
+        bursts = 300000 / every[i];
+        bb = log2i(bits[i]);
+        gb = log2i(every[i] - 1);
+        if (gb > 11) { gb = 11; }
+        expect(r.errors == (uint32_t)Injected && r.burst[bb] == bursts &&
+               r.gap[gb] == bursts - 1, name,
+               "E=%lu injected=%ld B[%d]=%u G[%d]=%u (expect %ld/%ld)",
+               (unsigned long)r.errors, Injected, bb, r.burst[bb], gb,
+               r.gap[gb], bursts, bursts - 1);
+    }
+}
+
+static void case_slip(void) {
+    core_result r;
+    char name[32];
+    int p;
+
+    for (p = 0; p < CORE_POLYS; p++) {
+        line_init(p);
+        Line.slip_at = 5000;
+        snprintf(name, sizeof name, "slip PN%d", core_deg[p]);
+        if (!run(&r, 125000, 10, 0, 0, 200000)) {
+            expect(0, name, "no lock");
+            continue;
+        }
+        /* the slip's errors are taken back out with the LOS window */
+        expect(r.sync_loss == 1 && r.errors <= 16, name,
+               "L=%u E=%lu", r.sync_loss, (unsigned long)r.errors);
+    }
+}
+
+static void case_edge(void) {
+    core_result r;
+    char name[32];
+    int p;
+
+    for (p = 0; p < CORE_POLYS; p++) {
+        line_init(p);
+        Line.edge = 1;               /* the core starts on the other edge */
+        snprintf(name, sizeof name, "edge PN%d", core_deg[p]);
+        if (!run(&r, 125000, 32, 0, 0, 200000)) {
+            expect(0, name, "no lock");
+            continue;
+        }
+        expect(r.errors == 0 && r.clock_neg == 1 && LockAt <= 256 + 12, name,
+               "C%u lock=%ld bytes E=%lu", r.clock_neg, LockAt,
+               (unsigned long)r.errors);
+    }
+}
+
+static void case_early(void) {
+    static const struct {
+        const char *name;
+        double   ber;                /* line */
+        uint32_t per;                /* limit: bytes per error */
+        int      verdict;            /* CORE_PASS / CORE_FAIL */
+    } t[] = {
+        {"early clean 1E-4",  0,    1250,    0},
+        {"early 1E-6 1E-4",   1e-6, 1250,    0},
+        {"early 1E-2 1E-3",   1e-2, 125,     1},
+        {"early 1E-5 1E-7",   1e-5, 1250000, 1},
+        {"early 5E-4 1E-3",   5e-4, 125,     0},
+        {"early 1.5E-3 1E-3", 1.5e-3, 125,   1},   /* EARLY_ERRS */
+    };
+    static const char *txt[] = {"PASS", "FAIL", "OPEN"};
+    core_result r;
+    uint32_t total = 12500000;
+    int i, v;
+
+    for (i = 0; i < (int)(sizeof t / sizeof t[0]); i++) {
+        line_init(1);
+        Line.ber = t[i].ber;
+        core_early_set(t[i].per);
+        if (!run(&r, total, 10, 0, 0, 13000000)) {
+            expect(0, t[i].name, "no lock");
+            continue;
+        }
+        v = core_early_verdict(t[i].per);
+        expect(r.errors == (uint32_t)Injected && r.bytes < total &&
+               v == t[i].verdict, t[i].name,
+               "E=%lu after %lu bytes, %s", (unsigned long)r.errors,
+               (unsigned long)r.bytes, txt[v]);
+    }
+
+    /* the 16th error on byte 256: the FAIL is decided on the byte that
+     * carries the low byte of CountBytes (MODE_BLOCK reads no stop key,
+     * so a missed end would only stop at the next PASS / FAIL) */
+    line_init(1);
+    Line.burst_every = 16;
+    Line.burst_bits  = 1;
+    core_early_set(125);
+    if (!run(&r, 12500, 10, 0, 0, 13000)) {
+        expect(0, "early FAIL on byte 256", "no lock");
+    } else {
+        expect(r.errors == 16 && r.bytes == 256 &&
+               core_early_verdict(125) == CORE_FAIL, "early FAIL on byte 256",
+               "E=%lu after %lu bytes", (unsigned long)r.errors,
+               (unsigned long)r.bytes);
+    }
+
+    /* one error every 150 bytes, below the 1E-3 limit (one in 125) yet
+     * never enough bytes for PASS: the run ends on the EARLY_ERRS-th
+     * error, and that is a FAIL */
+    line_init(1);
+    Line.burst_every = 150;
+    Line.burst_bits  = 1;
+    core_early_set(125);
+    if (!run(&r, total, 10, 0, 0, 13000000)) {
+        expect(0, "early EARLY_ERRS below L", "no lock");
+    } else {
+        v = core_early_verdict(125);
+        expect(r.errors == 100 && r.bytes == 15000 && r.errors <= r.bytes / 125 &&
+               v == CORE_FAIL, "early EARLY_ERRS below L",
+               "E=%lu after %lu bytes, %s", (unsigned long)r.errors,
+               (unsigned long)r.bytes, txt[v]);
+    }
+    core_early_set(0);
+}
+
+static void case_word(void) {
+    static const struct {
+        const char *name;
+        uint64_t word;               /* 0 = random */
+        int      len;
+        int      period;             /* WordLen to expect */
+        double   ber;
+    } t[] = {
+        {"word 101",          0x5,    3,  9,  0},
+        {"word A5",           0xA5,   8,  8,  0},
+        {"word 1234",         0x1234, 16, 16, 0},
+        {"word 37 bits",      0,      37, 37, 0},
+        {"word 64 bits",      0,      64, 64, 0},
+        {"word 64 bits 1E-4", 0,      64, 64, 1e-4},
+    };
+    core_result r;
+    uint64_t w;
+    int i;
+
+    for (i = 0; i < (int)(sizeof t / sizeof t[0]); i++) {
+        w = t[i].word;
+        if (w == 0) { w = ((uint64_t)rnd() << 32 | rnd()) >> (64 - t[i].len); }
+        word_init(w, t[i].len);
+        Line.ber = t[i].ber;
+        if (!run(&r, 125000, 10, 0, 0, 400000)) {
+            expect(0, t[i].name, "no lock");
+            continue;
+        }
+        expect(r.errors == (uint32_t)Injected && r.bytes == 125000 &&
+               r.sync_loss == 0 && r.word_len == t[i].period, t[i].name,
+               "period %u lock=%ld bytes E=%lu injected=%ld", r.word_len,
+               LockAt, (unsigned long)r.errors, Injected);
+    }
+}
+
+/*
+ * MODE_NRZ: the line as edge times (in nominal bits), sampled the way
+ * nrz_bit() does it: every 1/NRZ_OVS bit on an absolute schedule, each
+ * sample costing NRZ_COST, the byte work after every 8th bit NRZ_WORK.
+ * Late samples are taken when the loop gets there, flagged late. The
+ * recovered bytes are then counted as a replayed line.
+ */
+#define NRZ_BYTES  20000
+#define NRZ_COST   0.09              /* ~45 cycles at 9600 bit/s */
+
+static void case_nrz(void) {
+    static const struct {
+        const char *name;
+        int    poly;
+        double period;               /* line bit / nominal bit */
+        double jitter;               /* edge jitter, +-bits */
+        double work;                 /* byte work, bits */
+    } t[] = {
+        {"nrz PN9",             1, 1.0,   0,    0.4},
+        {"nrz PN9 +1%",         1, 1.01,  0,    0.4},
+        {"nrz PN9 -1%",         1, 0.99,  0,    0.4},
+        {"nrz PN23 +0.5% jit",  4, 1.005, 0.1,  0.4},
+        {"nrz PN23 -0.5% jit",  4, 0.995, 0.1,  0.4},
+        {"nrz PN15 work 0.7",   3, 1.0,   0.05, 0.7},
+    };
+    static uint8_t buf[NRZ_BYTES];
+    core_result r;
+    double now, ts, ideal, next;
+    long n, k;
+    int i, b, v, bits;
+    uint8_t acc;
+
+    for (i = 0; i < (int)(sizeof t / sizeof t[0]); i++) {
+        line_init(t[i].poly);
+        ideal = 0.3 + t[i].period;   /* end of bit 0 */
+        v     = ref_bit();
+        next  = ideal;
+        core_nrz_reset(0);
+
+        now = 0;
+        n = 0;
+        k = 0;
+        bits = 0;
+        acc = 0;
+        while (k < NRZ_BYTES) {
+            ts = (double)n++ / 4;    /* NRZ_OVS */
+            if (now < ts) { now = ts; }
+            while (now >= next) {
+                v      = ref_bit();
+                ideal += t[i].period;
+                next   = ideal + t[i].jitter * ((rnd() & 0xFFFF) / 32768.0 - 1);
+            }
+            b = core_nrz_sample((uint8_t)v, now > ts);
+            now += NRZ_COST;
+            if (b == CORE_NRZ_NONE) { continue; }
+
+            acc = (uint8_t)((acc << 1) | b);
+            if (++bits == 8) {
+                buf[k++] = acc;
+                bits = 0;
+                now += t[i].work;
+            }
+        }
+
+        Line.replay = buf;
+        if (!run(&r, NRZ_BYTES - 100, 10, 0, 0, NRZ_BYTES)) {
+            expect(0, t[i].name, "no lock");
+            continue;
+        }
+        expect(r.errors == 0 && r.sync_loss == 0, t[i].name,
+               "lock=%ld bytes E=%lu L=%u", LockAt,
+               (unsigned long)r.errors, r.sync_loss);
+    }
+}
+
+/* MODE_REP: blocks back to back, the run aborted half-way through the
+ * 11th; the snapshot must be the 10th block alone */
+static void case_rep(void) {
+    static const struct {
+        int    poly;
+        double ber;
+    } t[] = {
+        {1, 0}, {1, 1e-3}, {1, 1e-4}, {CORE_PN23, 1e-3}, {CORE_PN23, 1e-5},
+    };
+    core_result r;
+    char name[32];
+    long block = 12500;              /* 1E5 bits */
+    long e;
+    int i;
+
+    core_rep_set(1);
+    RepBlock = block;
+    for (i = 0; i < (int)(sizeof t / sizeof t[0]); i++) {
+        line_init(t[i].poly);
+        Line.ber = t[i].ber;
+        RepN = 0;
+        snprintf(name, sizeof name, "rep PN%d %.0e", core_deg[t[i].poly], t[i].ber);
+        if (run(&r, (uint32_t)block, 10, 0, 0, block * 10 + block / 2 + 64) ||
+            LockAt < 0) {
+            expect(0, name, "no lock or no abort");
+            continue;
+        }
+        core_result_get(&r);
+        e = (RepN >= 10) ? RepInj[9] - RepInj[8] : -1;
+        expect(RepN == 10 && r.snap_seq == 10 && r.snap_err == (uint32_t)e &&
+               r.snap_loss == 0 &&
+               r.errors == (uint32_t)(Injected - RepInj[9]), name,
+               "#%u E=%lu injected=%ld, open block E=%lu",
+               r.snap_seq, (unsigned long)r.snap_err, e,
+               (unsigned long)r.errors);
+    }
+    RepBlock = 0;
+    core_rep_set(0);
+}
+
+/* MODE_REP stopped with SW_SEL in block 8: 125-byte blocks (TBI 0)
+ * never see the 256-byte check, so rep_block() must stop them at the
+ * end of block 8; 12500-byte blocks stop at the 256-byte check and
+ * drop block 8 */
+static void case_rep_stop(void) {
+    static const long block[] = {125, 12500};
+    core_result r;
+    char name[32];
+    long want, e;
+    int i, ok;
+
+    core_rep_set(1);
+    for (i = 0; i < (int)(sizeof block / sizeof block[0]); i++) {
+        line_init(1);
+        Line.ber = 5e-3;
+        RepBlock = block[i];
+        RepN  = 0;
+        SelAt = block[i] * 7 + block[i] / 2;
+        snprintf(name, sizeof name, "rep stop %ld bytes", block[i]);
+        ok = run(&r, (uint32_t)block[i], 10, 0, 0, block[i] * 20 + 64);
+        core_result_get(&r);
+        want = (block[i] < 256) ? 8 : 7;
+        e = (RepN >= want) ? RepInj[want - 1] - RepInj[want - 2] : -1;
+        expect(ok && LockAt >= 0 && r.snap_seq == want &&
+               r.snap_err == (uint32_t)e,
+               name, "%s at %ld, #%u E=%lu injected=%ld",
+               ok ? "stopped" : "no stop", AfterLock, r.snap_seq,
+               (unsigned long)r.snap_err, e);
+    }
+    SelAt    = 0;
+    RepBlock = 0;
+    core_rep_set(0);
+}
+
+/* self_test(): pnX_test() and pn_crc[] against the reference LFSR,
+ * with a plain bit-loop CRC-16/CCITT */
+/*
+ * ENGINE_POLL against ENGINE_TMR0 on the same line (same Line and Rng
+ * for both runs): PN_FN(lock)() with its sync steps in the bit gaps,
+ * the count steps of the C loop (rx_cmp() in gap 8, rx_end() in gap 7
+ * of the next byte) and the MODE_NRZ loop must count exactly what
+ * PN_FN(sync)() and rx_byte() count, across a relock() and an early
+ * end as well.
+ */
+static int same_result(const core_result *a, const core_result *b) {
+    int i;
+
+    for (i = 0; i < 8; i++)  { if (a->burst[i] != b->burst[i]) { return 0; } }
+    for (i = 0; i < 12; i++) { if (a->gap[i] != b->gap[i]) { return 0; } }
+    return a->errors == b->errors && a->bytes == b->bytes &&
+           a->sync_loss == b->sync_loss && a->data_neg == b->data_neg &&
+           a->clock_neg == b->clock_neg && a->pass_at == b->pass_at &&
+           a->word_len == b->word_len;
+}
+
+static void case_engine(void) {
+    static const struct {
+        const char *name;
+        int      poly;
+        int      wlen;               /* CORE_WORD: random word of wlen bits */
+        double   ber;
+        long     burst_every;
+        int      burst_bits;
+        long     slip_at;
+        int      edge;
+        uint32_t per;                /* early limit, 0 = off */
+        uint32_t total;
+    } t[] = {
+        {"PN7 clean",      0, 0,  0,    0,   0, 0,    0, 0,    125000},
+        {"PN9 1E-3",       1, 0,  1e-3, 0,   0, 0,    0, 0,    125000},
+        {"PN11 burst",     2, 0,  0,    100, 3, 0,    0, 0,    125000},
+        {"PN15 slip 1E-4", 3, 0,  1e-4, 0,   0, 5000, 0, 0,    125000},
+        {"PN23 edge",      4, 0,  0,    0,   0, 0,    1, 0,    125000},
+        {"word 37 1E-4",   CORE_WORD, 37, 1e-4, 0, 0, 0, 0, 0, 125000},
+        {"early FAIL",     1, 0,  1e-2, 0,   0, 0,    0, 125,  12500000},
+        {"early PASS",     1, 0,  1e-6, 0,   0, 0,    0, 1250, 12500000},
+        {"early ERRS",     1, 0,  0,    150, 1, 0,    0, 125,  12500000},
+    };
+    static const char *eng[] = {"", "poll", "nrz"};
+    core_result r0, r1;
+    line_cfg line;
+    uint32_t rng;
+    long lock0;
+    char name[32];
+    int i, e, ok, v0, v1;
+
+    for (i = 0; i < (int)(sizeof t / sizeof t[0]); i++) {
+        if (t[i].poly == CORE_WORD) {
+            word_init(((uint64_t)rnd() << 32 | rnd()) >> (64 - t[i].wlen), t[i].wlen);
+        } else {
+            line_init(t[i].poly);
+        }
+        Line.ber         = t[i].ber;
+        Line.burst_every = t[i].burst_every;
+        Line.burst_bits  = t[i].burst_bits;
+        Line.slip_at     = t[i].slip_at;
+        Line.edge        = t[i].edge;
+        line = Line;
+        rng  = Rng;
+        core_early_set(t[i].per);
+
+        core_engine_set(CORE_TMR0);
+        ok = run(&r0, t[i].total, 10, 0, 0, t[i].total + 1000);
+        lock0 = LockAt;
+        v0 = core_early_verdict(t[i].per ? t[i].per : 1);
+
+        for (e = CORE_POLL; e <= CORE_NRZ; e++) {
+            snprintf(name, sizeof name, "engine %s %s", eng[e], t[i].name);
+            if (!ok) {
+                expect(0, name, "no lock (ENGINE_TMR0)");
+                continue;
+            }
+            Line = line;
+            Rng  = rng;
+            core_engine_set((uint8_t)e);
+            if (!run(&r1, t[i].total, 10, 0, 0, t[i].total + 1000)) {
+                expect(0, name, "no lock");
+                continue;
+            }
+            v1 = core_early_verdict(t[i].per ? t[i].per : 1);
+            expect(same_result(&r0, &r1) && LockAt == lock0 && v1 == v0, name,
+                   "E=%lu/%lu bytes=%lu/%lu L=%u/%u lock=%ld/%ld",
+                   (unsigned long)r1.errors, (unsigned long)r0.errors,
+                   (unsigned long)r1.bytes, (unsigned long)r0.bytes,
+                   r1.sync_loss, r0.sync_loss, LockAt, lock0);
+        }
+    }
+    core_engine_set(CORE_TMR0);
+    core_early_set(0);
+}
+
+static void case_selftest(void) {
+    char name[32];
+    uint16_t crc, got, rom;
+    long n, len;
+    int p, b;
+
+    for (p = 0; p < CORE_POLYS; p++) {
+        line_init(p);
+        Line.hist = 0xFFFFFFFF;      /* the all-ones seed, no random phase */
+        len = (core_deg[p] <= 11) ? (1L << core_deg[p]) / 8 : 512;
+        crc = 0xFFFF;
+        for (n = 0; n < len * 8; n++) {
+            b = ref_bit() ^ core_inv[p];
+            crc ^= (uint16_t)(b << 15);
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        got = core_pn_test((uint8_t)p);
+        rom = core_pn_crc((uint8_t)p);
+        snprintf(name, sizeof name, "selftest PN%d", core_deg[p]);
+        expect(got == crc && rom == crc, name, "%04X rom %04X ref %04X (%ld bits)",
+               got, rom, crc, len * 8);
+    }
+}
+
+static void case_fmt(void) {
+    char txt[10];
+    long i, bad = 0;
+    uint32_t num, den;
+    double ber, got, ulp;
+    int e;
+
+    for (i = 0; i < 200000; i++) {
+        den = rnd() >> (rnd() % 32);
+        if (den == 0) { den = 1; }
+        num = (uint32_t)(((uint64_t)rnd() << 3) % ((uint64_t)den * 8 + 1));
+        if (num == 0) { num = 1; }
+        core_fmt_ber(num, den, txt);
+
+        ber = num / (8.0 * den);
+        got = atof(txt);
+        e   = (int)floor(log10(got));
+        ulp = pow(10, e - 2);        /* one unit in the last digit */
+        if (fabs(got - ber) > 0.6 * ulp) {
+            if (bad++ < 5) { printf("     fmt_ber(%lu, %lu) = %s, %.4e\n",
+                                   (unsigned long)num, (unsigned long)den, txt, ber); }
+        }
+    }
+    core_fmt_ber(0, 100, txt);
+    expect(bad == 0 && strcmp(txt, "0") == 0, "fmt_ber", "%ld of 200000 off", bad);
+}
+
+/* cont_step(): one screen after another on the same frame buffer (old
+ * digits must go), random counters of every size; the BER must be the
+ * text of fmt_ber(), the counts those of the ENGINE_TMR0 live_step() */
+static void case_live_cont(void) {
+    char got[34], want[40], ber[10];
+    long i, bad = 0, div = 0;
+    uint32_t num, den, kb;
+    uint64_t top;
+    unsigned steps, most = 0;
+    char unit;
+
+    core_live_init(0);
+    for (i = 0; i < 200000; i++) {
+        den = rnd() >> (rnd() % 24);
+        if (den < 256) { den = 256; }          /* LiveDue: 256 bytes on */
+        top = (uint64_t)den * 8;
+        num = (uint32_t)(((uint64_t)rnd() << 3) % (top + 1)) >> (rnd() % 32);
+        if (i % 100 == 0) { num = 0; }
+
+        kb = rnd();
+        if (core_div10(den) != den / 10 || core_div10(kb) != kb / 10 ||
+            core_div10(0xFFFFFFFF - i) != (0xFFFFFFFF - i) / 10) { div++; }
+
+        steps = core_cont_live(num, den, got);
+        if (steps > most) { most = steps; }
+
+        core_fmt_ber(num, den, ber);
+        kb   = den / 125;
+        unit = 'k';
+        if (kb >= 100000) {
+            kb  /= 1000;
+            unit = 'M';
+        }
+        snprintf(want, sizeof want, "%-8s %5lu%cb\nE=%10lu    ", ber,
+                 (unsigned long)kb, unit, (unsigned long)num);
+        if (strcmp(got, want) != 0 && bad++ < 5) {
+            printf("     cont_step(%lu, %lu):\n%s\n     expected:\n%s\n",
+                   (unsigned long)num, (unsigned long)den, got, want);
+        }
+    }
+    expect(bad == 0 && div == 0, "live cont",
+           "%ld of 200000 off, at most %u steps, div10() %ld off",
+           bad, most, div);
+}
+
+/* rep_step(): the same for the MODE_REP screen; rep_ber() takes the BER
+ * from the error digits of a 10^k-bit block */
+static void case_live_rep(void) {
+    char got[34], want[40], ber[10], loss[4];
+    long i, bad = 0;
+    uint64_t block;
+    uint32_t num;
+    unsigned tbi, seq, l;
+
+    core_live_init(1);
+    for (i = 0; i < 100000; i++) {
+        tbi   = rnd() % 8;
+        block = 125;
+        for (l = 0; l < tbi; l++) { block *= 10; }
+        num = (uint32_t)((((uint64_t)rnd() << 3) % (block * 8 + 1)) >> (rnd() % 32));
+        if (i % 100 == 0) { num = 0; }
+        seq = rnd() & 0xFFFF;
+        l   = (rnd() % 4) ? 0 : rnd() % 100;
+
+        core_rep_live(num, (uint16_t)seq, (uint8_t)l, (uint8_t)tbi, got);
+
+        core_fmt_ber(num, (uint32_t)block, ber);
+        if (l) { snprintf(loss, sizeof loss, "L%2u", l); }
+        else   { strcpy(loss, "   "); }
+        snprintf(want, sizeof want, "#%5u %-9s\nE=%10lu %s", seq, ber,
+                 (unsigned long)num, loss);
+        if (strcmp(got, want) != 0 && bad++ < 5) {
+            printf("     rep_step(%lu, #%u, L%u, TBI %u):\n%s\n     expected:\n%s\n",
+                   (unsigned long)num, seq, l, tbi, got, want);
+        }
+    }
+    expect(bad == 0, "live rep", "%ld of 100000 off", bad);
+}
+
+/* -------- benchmark -------- */
+
+#define BENCH_BYTES  4000000L
+#define BENCH_SYNC   1024            /* room for the sync phase */
+
+static void bench(void) {
+    core_result r;
+    struct timespec t0, t1;
+    uint8_t *buf;
+    double ns;
+    int p;
+    long i;
+
+    /* the line is made first, so only the core is timed */
+    buf = malloc(BENCH_BYTES + BENCH_SYNC);
+    if (!buf) { return; }
+
+    for (p = 0; p <= CORE_WORD; p++) {
+        if (p == CORE_WORD) { word_init(0x1F2E3D4C5BULL, 37); }
+        else                { line_init(p); }
+        for (i = 0; i < BENCH_BYTES + BENCH_SYNC; i++) { buf[i] = line_byte(); }
+        Line.replay = buf;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        run(&r, BENCH_BYTES, 10, 0, 0, BENCH_BYTES + BENCH_SYNC);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        if (p == CORE_WORD) { printf("W%-3u ", r.word_len); }
+        else                { printf("PN%-2d ", core_deg[p]); }
+        printf(" %lu bytes  E=%lu  %.2f ns/bit (host)\n",
+               (unsigned long)r.bytes, (unsigned long)r.errors,
+               ns / (8.0 * r.bytes));
+    }
+    free(buf);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench();
+        return 0;
+    }
+
+    case_clean();
+    case_ber();
+    case_burst();
+    case_slip();
+    case_edge();
+    case_early();
+    case_word();
+    case_nrz();
+    case_rep();
+    case_rep_stop();
+    case_engine();
+    case_selftest();
+    case_fmt();
+    case_live_cont();
+    case_live_rep();
+
+    printf("%d cases, %d failed\n", Cases, Fails);
+    return Fails != 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * lcd_fb.c
+ * RAM shadow ("frame buffer") for the 1602 LCD, used by BERT.c (CCS C).
+ *
+ * Screens are written into LcdFb[] with printf(fb_putc, ...), which only
+ * costs RAM writes. fb_task() then pushes at most ONE changed character
+ * (plus a cursor move if needed) to the lcd_b.c driver per call, so the
+ * busy/delay timing of the LCD is spread over idle time instead of
+ * blocking the caller for a whole screen.
+ *
+ *   fb_init()      : after lcd_init(); shadow = blank screen
+ *   fb_putc(c)     : printf() sink; '\f' clears, '\n' goes to line 2
+ *   fb_put(pos, c) : one character at 0..31 (line 1 = 0..15)
+ *   fb_task()      : push one changed character, FALSE if none left
+ *   fb_flush()     : push everything (blocking, for UI screens)
+ */
+
+char LcdFb[32];              // what the screen should show
+int  LcdDirty[4];            // 1 bit per position: LcdFb[] not on the LCD yet
+int  FbPos;                  // fb_putc() cursor
+int  FbScan;                 // next position fb_task() looks at
+int  LcdCur;                 // LCD cursor position, 0xFF = unknown
+
+int const fb_bit[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+
+/* --------------------------------------------------------
+ * fb_init()
+ * - lcd_init() has just cleared the display.
+ * -------------------------------------------------------- */
+void fb_init() {
+    int i;
+
+    for (i = 0; i < 32; i++) { LcdFb[i] = ' '; }
+    for (i = 0; i < 4; i++)  { LcdDirty[i] = 0; }
+
+    FbPos  = 0;
+    FbScan = 0;
+    LcdCur = 0xFF;
+}
+
+/* --------------------------------------------------------
+ * fb_put()
+ * - Marks the position dirty only if the character really changes,
+ *   so redrawing an unchanged screen costs no LCD traffic.
+ * -------------------------------------------------------- */
+void fb_put(int pos, char c) {
+    if (LcdFb[pos] != c) {
+        LcdFb[pos] = c;
+        LcdDirty[pos >> 3] |= fb_bit[pos & 7];
+    }
+}
+
+/* --------------------------------------------------------
+ * fb_putc()
+ * - Same control characters as lcd_putc() for '\f' and '\n'.
+ * - Characters past the end of line 2 are dropped.
+ * -------------------------------------------------------- */
+void fb_putc(char c) {
+    int i;
+
+    switch (c) {
+        case '\f':
+            for (i = 0; i < 32; i++) { fb_put(i, ' '); }
+            FbPos = 0;
+            break;
+
+        case '\n':
+            FbPos = 16;
+            break;
+
+        default:
+            if (FbPos < 32) { fb_put(FbPos++, c); }
+            break;
+    }
+}
+
+/* --------------------------------------------------------
+ * fb_task()
+ * - Pushes the next dirty character, round-robin from FbScan.
+ * - The LCD auto-increments its cursor, so a run of changed characters
+ *   needs only one lcd_gotoxy(). DDRAM is not contiguous between the
+ *   two lines, so the cursor is "unknown" after column 16.
+ * - The scan skips the rest of a clean group of 8 in one step, so it
+ *   looks at no more than 11 positions (the live screen of
+ *   ENGINE_POLL calls this between two bits, poll_step()).
+ * - Returns TRUE if a character was sent.
+ * -------------------------------------------------------- */
+short fb_task() {
+    int pos, m;
+
+    if ((LcdDirty[0] | LcdDirty[1] | LcdDirty[2] | LcdDirty[3]) == 0) {
+        return FALSE;
+    }
+
+    while (TRUE) {                           // ends: some bit is dirty
+        pos = FbScan;
+        if (LcdDirty[pos >> 3] == 0) {
+            FbScan = ((pos | 7) + 1) & 31;
+            continue;
+        }
+        FbScan = (FbScan + 1) & 31;
+
+        m = fb_bit[pos & 7];
+        if (LcdDirty[pos >> 3] & m) {
+            LcdDirty[pos >> 3] &= ~m;
+
+            if (pos != LcdCur) { lcd_gotoxy((pos & 15) + 1, (pos >> 4) + 1); }
+            lcd_putc(LcdFb[pos]);
+
+            LcdCur = pos + 1;
+            if ((LcdCur & 15) == 0) { LcdCur = 0xFF; }
+            return TRUE;
+        }
+    }
+}
+
+/* --------------------------------------------------------
+ * fb_flush()
+ * - Blocking: until the LCD shows LcdFb[].
+ * -------------------------------------------------------- */
+void fb_flush() {
+    while (fb_task());
+}
@@ -0,0 +1,116 @@
+/*
+ * lcd_u.c
+ * HD44780 4-bit LCD driver for BERT.c when the USART owns RB1/RB2 (CCS C).
+ *
+ * Same calls as CCS lcd_b.c, as far as lcd_fb.c uses them:
+ *   lcd_init(), lcd_gotoxy(x, y), lcd_putc(c)  ('\f', '\n', '\b')
+ *
+ * Pin map (lcd_b.c in brackets):
+ *   RB0      : E      (RB0)
+ *   RB3      : RS     (RB1, now USART RX)
+ *   RB4..RB7 : D4..D7 (RB4..RB7)
+ *   R/W      : tied to GND (RB2, now USART TX)
+ *
+ * R/W is not connected, so the busy flag cannot be read: every write
+ * waits the HD44780 execution time instead (37us, 1.52ms for clear).
+ * Pins are driven with output_bit() one at a time, which leaves TRISB1/2
+ * alone for the USART.
+ */
+
+#define LCD_E     PIN_B0
+#define LCD_RS    PIN_B3
+#define LCD_D4    PIN_B4
+#define LCD_D5    PIN_B5
+#define LCD_D6    PIN_B6
+#define LCD_D7    PIN_B7
+
+#define lcd_line_two  0x40   // LCD RAM address for the second line
+
+/* --------------------------------------------------------
+ * lcd_send_nibble()
+ * - Low 4 bits of n to D4..D7, one E pulse.
+ * -------------------------------------------------------- */
+void lcd_send_nibble(int n) {
+    output_bit(LCD_D4, bit_test(n, 0));
+    output_bit(LCD_D5, bit_test(n, 1));
+    output_bit(LCD_D6, bit_test(n, 2));
+    output_bit(LCD_D7, bit_test(n, 3));
+
+    delay_cycles(1);
+    output_high(LCD_E);
+    delay_us(2);
+    output_low(LCD_E);
+}
+
+/* --------------------------------------------------------
+ * lcd_send_byte()
+ * - address: 0 = command, 1 = data.
+ * -------------------------------------------------------- */
+void lcd_send_byte(int address, int n) {
+    output_bit(LCD_RS, address);
+    lcd_send_nibble(n >> 4);
+    lcd_send_nibble(n & 0x0F);
+    delay_us(50);
+}
+
+/* --------------------------------------------------------
+ * lcd_init()
+ * - 4-bit, 2 lines, 5x8 font, display on, cursor off, increment.
+ * -------------------------------------------------------- */
+void lcd_init() {
+    int i;
+
+    output_low(LCD_RS);
+    output_low(LCD_E);
+    delay_ms(15);
+
+    for (i = 0; i < 3; i++) {
+        lcd_send_nibble(3);
+        delay_ms(5);
+    }
+    lcd_send_nibble(2);
+    delay_us(50);
+
+    lcd_send_byte(0, 0x28);
+    lcd_send_byte(0, 0x0C);
+    lcd_send_byte(0, 0x01);
+    delay_ms(2);
+    lcd_send_byte(0, 0x06);
+}
+
+/* --------------------------------------------------------
+ * lcd_gotoxy()
+ * - x = 1..16, y = 1..2 (same as lcd_b.c).
+ * -------------------------------------------------------- */
+void lcd_gotoxy(int x, int y) {
+    int address;
+
+    if (y != 1) { address = lcd_line_two; }
+    else        { address = 0; }
+    address += x - 1;
+    lcd_send_byte(0, 0x80 | address);
+}
+
+/* --------------------------------------------------------
+ * lcd_putc()
+ * -------------------------------------------------------- */
+void lcd_putc(char c) {
+    switch (c) {
+        case '\f':
+            lcd_send_byte(0, 1);
+            delay_ms(2);
+            break;
+
+        case '\n':
+            lcd_gotoxy(1, 2);
+            break;
+
+        case '\b':
+            lcd_send_byte(0, 0x10);
+            break;
+
+        default:
+            lcd_send_byte(1, c);
+            break;
+    }
+}
@@ -0,0 +1,295 @@
+/*
+ * live.c
+ * Live screens of MODE_CONT and MODE_REP, the parts with no SFR and no
+ * division (BERT.c, CCS C). Included by BERT.c after bert_core.c;
+ * host/ builds it as well and checks the screens against fmt_ber().
+ *
+ *   live_init()  : fixed parts of the screen, before the run
+ *   live_dec()   : one digit by subtraction into LcdFb[]
+ *   rep_step()   : MODE_REP, one step of the snapshot screen
+ *   cont_step()  : MODE_CONT (POLL_LIVE), one step of the running BER
+ *
+ * Needs from BERT.c: LiveStep / LiveNum (POLL_LIVE: LiveDen / LiveM /
+ * LiveE), USE_REP's RepTbi / RepSeq / RepLoss, Mode, and lcd_fb.c.
+ */
+
+#if BERT_ENGINE == ENGINE_TMR0 || POLL_LIVE
+/* --------------------------------------------------------
+ * live_init()
+ * - Fixed parts of the live screen, called before a MODE_CONT or
+ *   MODE_REP run (ENGINE_POLL: with LivePoll only).
+ * -------------------------------------------------------- */
+void live_init() {
+    if (Mode == MODE_CONT) {
+        printf(fb_putc, "\f0              b\nE=");
+    }
+#if USE_REP
+    if (Mode == MODE_REP) {
+        printf(fb_putc, "\f#0  first block\nE=");
+    }
+#endif
+
+    LiveDue  = FALSE;
+    LiveStep = 0;
+}
+#endif
+
+#if (USE_REP && BERT_ENGINE == ENGINE_TMR0) || POLL_LIVE
+int32 const dec_pow[10] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+                           10000000, 100000000, 1000000000};
+
+/* --------------------------------------------------------
+ * live_dec()
+ * - The digit of LiveNum at place value p (dec_pow[], kb_pow[]) into
+ *   LcdFb[pos], left to right: at most nine int32 subtractions, no
+ *   division, and LiveNum keeps the rest.
+ * - A leading zero (the character before is no digit, i.e. the '#' /
+ *   '=' of the layout or a blank) becomes a blank; the units digit is
+ *   always shown.
+ * -------------------------------------------------------- */
+void live_dec(int pos, int32 p, short units) {
+    int d;
+    char c;
+
+    d = 0;
+    while (LiveNum >= p) { LiveNum -= p; d++; }
+
+    c = LcdFb[pos - 1];
+    if (d == 0 && !units && (c < '0' || c > '9')) { fb_put(pos, ' '); }
+    else                                           { fb_put(pos, '0' + d); }
+}
+#endif
+
+#if USE_REP && (BERT_ENGINE == ENGINE_TMR0 || POLL_LIVE)
+/* --------------------------------------------------------
+ * rep_ber()
+ * - BER of the snapshot from its error digits in LcdFb[18..27], as
+ *   fmt_ber() would give it, into BerTxt. A block is 10^k bits
+ *   (k = RepTbi + 3), so the BER is the error count times 10^-k: the
+ *   mantissa is its first digits, rounded on the fourth, and no
+ *   multiply or division is needed.
+ * -------------------------------------------------------- */
+void rep_ber() {
+    int i, n, e, d;
+    long m;
+
+    i = 18;
+    while (LcdFb[i] == ' ') { i++; }         // [27] is always a digit
+    n = 28 - i;
+
+    if (n == 1 && LcdFb[27] == '0') {
+        strcpy(BerTxt, "0");
+        return;
+    }
+
+    m = LcdFb[i] - '0';
+    m = (m << 6) + (m << 5) + (m << 2);      // * 100
+    if (n > 1) {
+        d = LcdFb[i + 1] - '0';
+        m += (d << 3) + (d << 1);            // * 10
+    }
+    if (n > 2) { m += LcdFb[i + 2] - '0'; }
+    if (n > 3 && LcdFb[i + 3] >= '5') { m++; }
+    e = RepTbi + 3 - (n - 1);
+    if (m == 1000) { m = 100; e--; }
+
+    ber_txt(m, e);
+}
+
+/* --------------------------------------------------------
+ * rep_show()
+ * - BerTxt into LcdFb[7..15], the re-locks of the block at [29..31].
+ * -------------------------------------------------------- */
+void rep_show() {
+    int i, n;
+
+    fb_put(6, ' ');
+    n = 0;
+    for (i = 7; i < 16; i++) {
+        if (BerTxt[n]) { fb_put(i, BerTxt[n++]); }
+        else           { fb_put(i, ' '); }
+    }
+
+    fb_put(28, ' ');
+    if (RepLoss) {
+        fb_put(29, 'L');
+        if (RepLoss >= 10) { fb_put(30, '0' + RepLoss / 10); }
+        else               { fb_put(30, ' '); }
+        fb_put(31, '0' + RepLoss % 10);
+    } else {
+        fb_put(29, ' ');
+        fb_put(30, ' ');
+        fb_put(31, ' ');
+    }
+}
+
+/* --------------------------------------------------------
+ * rep_step()
+ * - live_step() of MODE_REP, the last snapshot:
+ *     #12    1.23E-05     block number, BER of the block
+ *     E=        12 L1     error bits, re-locks in the block
+ *     step  1..10 : error digits        -> LcdFb[18..27]
+ *     step 11     : rep_ber()
+ *     step 12     : rep_show()
+ *     step 13..17 : block number digits -> LcdFb[1..5]
+ * - The snapshot is taken at step 0, a block ending meanwhile is
+ *   shown on the next round.
+ * - Every step is short enough for a byte gap of ENGINE_POLL
+ *   (poll_step()): digits by live_dec(), the BER in two steps.
+ * -------------------------------------------------------- */
+void rep_step() {
+    if (LiveStep == 0) {
+        if (!SnapDue) { return; }
+        SnapDue  = FALSE;
+        LiveNum  = SnapErr;
+        RepSeq   = SnapSeq;
+        RepLoss  = SnapLoss;
+        LiveStep = 1;
+        return;
+    }
+
+    if (LiveStep <= 10) {
+        live_dec(17 + LiveStep, dec_pow[10 - LiveStep], LiveStep == 10);
+    } else if (LiveStep == 11) {
+        rep_ber();
+    } else if (LiveStep == 12) {
+        rep_show();
+        LiveNum = RepSeq;
+    } else {
+        live_dec(LiveStep - 12, dec_pow[17 - LiveStep], LiveStep == 17);
+    }
+
+    if (++LiveStep == 18) { LiveStep = 0; }
+}
+#endif
+
+#if POLL_LIVE
+int32 const kb_pow[8] = {125, 1250, 12500, 125000, 1250000, 12500000,
+                         125000000, 1250000000};   // bytes in 10^k kbit
+
+/* --------------------------------------------------------
+ * div10()
+ * - n / 10 without the int32 division routine: n * 0.8 by shifts and
+ *   adds, / 8, then the remainder corrects the last unit. About 250
+ *   cycles.
+ * -------------------------------------------------------- */
+int32 div10(int32 n) {
+    int32 q;
+
+    q  = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+    if (n - ((q << 3) + (q << 1)) > 9) { q++; }
+    return q;
+}
+
+/* --------------------------------------------------------
+ * cont_num()
+ * - Five more error digits from LcdFb[i..i+4] into LiveNum (a blank
+ *   is a leading zero): cont_step() takes the error count back from
+ *   the screen instead of keeping a copy.
+ * -------------------------------------------------------- */
+void cont_num(int i) {
+    int n;
+
+    for (n = 0; n < 5; n++) {
+        LiveNum = (LiveNum << 3) + (LiveNum << 1);
+        if (LcdFb[i] != ' ') { LiveNum += LcdFb[i] - '0'; }
+        i++;
+    }
+}
+
+/* --------------------------------------------------------
+ * cont_step()
+ * - live_step() of MODE_CONT for poll_step(), the same screen:
+ *     1.23E-05 12345kb      running BER, bits counted
+ *     E=        12          error bits
+ *     step  0     : take the counters
+ *     step  1..10 : error count digits        -> LcdFb[18..27]
+ *     step 11     : kbit, or Mbit from 100000 kbit on
+ *     step 12..16 : bit count digits          -> LcdFb[9..13]
+ *     step 17..18 : the error count back from LcdFb[18..27]
+ *     step 19..25 : fmt_ber()                 -> LcdFb[0..7]
+ * - fmt_ber() taken apart: its loops become steps 19 and 20, which
+ *   repeat (one div10() or one times ten per byte) until done, then
+ *   one mantissa digit per step. The BER is the one fmt_ber() gives.
+ * - The counters are read in one gap, after rx_wrap() has carried
+ *   them, so the BER and the error count are of the same byte.
+ * -------------------------------------------------------- */
+void cont_step() {
+    int i, d;
+
+    if (LiveStep == 0) {
+        if (!LiveDue) { return; }
+        LiveDue  = FALSE;
+        LiveNum  = ErrorBits.w;
+        LiveDen  = CountBytes.w;
+        LiveStep = 1;
+        return;
+    }
+
+    if (LiveStep <= 10) {
+        live_dec(17 + LiveStep, dec_pow[10 - LiveStep], LiveStep == 10);
+    } else if (LiveStep == 11) {
+        LiveNum = LiveDen;
+        LiveE   = 0;                         // kb_pow[] offset
+        fb_put(14, 'k');
+        if (LiveDen >= 12500000) {           // 100000 kbit
+            LiveE = 3;
+            fb_put(14, 'M');
+        }
+    } else if (LiveStep <= 16) {
+        live_dec(LiveStep - 3, kb_pow[16 - LiveStep + LiveE], LiveStep == 16);
+    } else if (LiveStep == 17) {
+        LiveNum = 0;
+        cont_num(18);
+    } else if (LiveStep == 18) {
+        cont_num(23);
+        LiveE = 0;
+        LiveM = 0;                           // stays 0 for BER "0"
+        if (LiveNum == 0) {
+            strcpy(BerTxt, "0");
+            LiveStep = 25;
+            return;
+        }
+    } else if (LiveStep == 19) {
+        if (LiveDen > 0x03333333) {          // > 4E8 bits: drop digits
+            LiveDen = div10(LiveDen);
+            LiveE++;
+            return;
+        }
+        LiveDen <<= 3;                       // bytes -> bits
+    } else if (LiveStep == 20) {
+        if (LiveE && LiveNum >= (LiveDen << 3) + (LiveDen << 1)) {
+            LiveNum = div10(LiveNum);
+            LiveE--;
+            return;
+        }
+        if (LiveNum < LiveDen) {
+            LiveNum = (LiveNum << 3) + (LiveNum << 1);
+            LiveE++;
+            return;
+        }
+    } else if (LiveStep <= 24) {
+        d = 0;
+        while (LiveNum >= LiveDen) { LiveNum -= LiveDen; d++; }
+        LiveNum = (LiveNum << 3) + (LiveNum << 1);
+        if (LiveStep < 24) { LiveM = (LiveM << 3) + (LiveM << 1) + d; }
+        else if (d >= 5)   { LiveM++; }      // rounded to 3 digits
+    } else {
+        if (LiveM) {
+            if (LiveM == 1000) { LiveM = 100; LiveE--; }
+            ber_txt(LiveM, LiveE);
+        }
+        i = 0;
+        while (BerTxt[i]) { fb_put(i, BerTxt[i]); i++; }
+        while (i < 8)     { fb_put(i++, ' '); }
+        LiveStep = 0;
+        return;
+    }
+
+    LiveStep++;
+}
+#endif
@@ -0,0 +1,704 @@
+/*
+ * pn_loop.c
+ * Per-polynomial LFSR engine for BERT.c (CCS C).
+ *
+ * This file is a template: BERT.c includes it once per compiled-in PN
+ * polynomial, after defining
+ *
+ *   PN_N      : register length  (x^PN_N + x^PN_K + 1)
+ *   PN_K      : middle tap
+ *   PN_FN(f)  : name of the generated functions, e.g. pn9_##f
+ *
+ * so every polynomial gets its own constant-tap code and nothing on the
+ * per-bit path looks the taps up at run time:
+ *
+ *   PN_FN(next)()  : next 8 expected bits (oldest in bit 7)
+ *   PN_FN(test)()  : CRC of next() from the all-ones seed (self_test())
+ *   PN_FN(sync)()  : seed-based lock, one received byte per call; its
+ *                    steps PN_FN(sync_alt)() .. PN_FN(sync_cmp)()
+ *   PN_FN(count)() : sync + count phase for the selected BERT_ENGINE,
+ *                    back to sync on loss of sync
+ *   PN_FN(lock)()  : the ENGINE_POLL sync phase on CLK_IN / DATA_IN
+ *   PN_FN(cap)()   : the same on CapBuf[] bursts (MODE_CAP, USE_CAP)
+ *   PN_FN(gen)()   : generator / loopback (MODE_GEN, MODE_LOOP, USE_GEN)
+ *   PN_FN(lane)()  : DATA_IN plus the RB4..RB7 lanes (MODE_LANE, USE_LANE)
+ *   PN_FN(nrz)()   : sync + count on bits recovered by nrz_bit()
+ *                    (MODE_NRZ, USE_NRZ)
+ *
+ * Every count-phase PN_FN(next)() is followed by INJ_BYTE() (USE_INJ).
+ *
+ * Recurrence (ITU-T O.150 shift register, newest bit in PnHist bit 0):
+ *   b(n) = b(n-PN_N) ^ b(n-PN_K)
+ *
+ * With PN_WORD defined instead of PN_N / PN_K, next() and sync() are
+ * those of the learned word (POLY_WORD, USE_WORD):
+ *   b(n) = b(n-WordP)
+ * and everything after them is shared.
+ */
+
+#ifdef PN_WORD
+/* --------------------------------------------------------
+ * PN_FN(next)()   (PN_WORD)
+ * - The 8 bits of WordP clocks ago from WordRing[]; the new byte goes
+ *   into the ring as well, so the word repeats by itself.
+ * -------------------------------------------------------- */
+int PN_FN(next)() {
+    int t;
+
+    t = WordRing[(WordPos + 1 - WordQ) & WORD_MASK] >> WordR;
+    if (WordR) { t |= WordRing[(WordPos - WordQ) & WORD_MASK] << (8 - WordR); }
+
+    WordPos = (WordPos + 1) & WORD_MASK;
+    WordRing[WordPos] = t;
+    return t;
+}
+
+/* --------------------------------------------------------
+ * PN_FN(sync_xxx)()   (PN_WORD)
+ * - LOAD / VERIFY as for the polynomials, with WordP bits of seed and
+ *   ThresError + WORD_MAX bits to verify: every bit of the word is
+ *   then checked at least once against its repeat.
+ * - A mismatch tries the next period (word_period()), so the first
+ *   sync learns the word; after a relock() the learned period is
+ *   tried first again.
+ * - No inverted-seed test (sync_alt / sync_swap do nothing): an
+ *   inverted word is just another word. AUTO_POL still flips the
+ *   clock edge every 256 bytes.
+ * -------------------------------------------------------- */
+void PN_FN(sync_alt)() {
+}
+
+void PN_FN(sync_swap)() {
+}
+
+void PN_FN(sync_exp)() {
+    if (SyncLoad >= WordP) { PnExp = PN_FN(next)(); }
+}
+
+short PN_FN(sync_cmp)(int r) {
+    r ^= DataMask;
+
+#if AUTO_POL
+    if (++SyncTry == 0) {
+        clock_flip();
+        SyncLoad = 0;
+        RenzokuError = 0;
+        return FALSE;
+    }
+#endif
+
+    if (SyncLoad < WordP) {
+        WordPos = (WordPos + 1) & WORD_MASK;
+        WordRing[WordPos] = r;
+        SyncLoad += 8;
+        return FALSE;
+    }
+
+    if (r != PnExp) {
+        word_period(WordP + 1);
+        SyncLoad = 0;
+        RenzokuError = 0;
+        return FALSE;
+    }
+
+    // 8-bit sum: ThresError <= 128 (thr_tab[], main() clamps the EEPROM)
+    if (ThresError + WORD_MAX - RenzokuError <= 8) {
+        WordLen = WordP;
+        return TRUE;
+    }
+    RenzokuError += 8;
+    return FALSE;
+}
+#else
+
+#if PN_K < 4
+#error "pn_loop.c: the 8-bit parallel form needs PN_K >= 4"
+#endif
+
+/* Low 16 bits are enough below PN17; avoids int32 shifts */
+#if PN_N > 16
+#define PN_H      PnHist
+#else
+#define PN_H      ((long)PnHist)
+#endif
+
+/* --------------------------------------------------------
+ * PN_FN(next)()
+ * - Advances the LFSR by 8 bits and returns them.
+ * - T = terms that come straight from the history, then the few bits
+ *   that depend on b(n)..b(n+7) themselves (taps shorter than 8) are
+ *   folded in from the top of T. PN_K >= 4 keeps that one XOR deep.
+ * -------------------------------------------------------- */
+int PN_FN(next)() {
+    int t;
+
+#if PN_N >= 8
+    t  = (int)(PN_H >> (PN_N - 8));
+#else
+    t  = make8(PnHist, 0) << (8 - PN_N);
+#endif
+#if PN_K >= 8
+    t ^= (int)(PN_H >> (PN_K - 8));
+#else
+    t ^= make8(PnHist, 0) << (8 - PN_K);
+    t ^= t >> PN_K;
+#endif
+#if PN_N < 8
+    t ^= t >> PN_N;
+#endif
+
+    PnHist = (PnHist << 8) | t;
+    return t;
+}
+
+/* Self-test length in bytes: 2^PN_N bits covers the full period up to
+ * PN11; PN15 / PN23 would take 0.3 s / 8 s, so they check 4096 bits */
+#if PN_N <= 11
+#define PN_TEST   ((1L << PN_N) / 8)
+#else
+#define PN_TEST   512L
+#endif
+
+/* --------------------------------------------------------
+ * PN_FN(test)()
+ * - PN_TEST bytes of PN_FN(next)() from the all-ones seed through
+ *   crc16(), for self_test() to compare with pn_crc[]. The register
+ *   is left wherever the test ends: every run seeds it again.
+ * -------------------------------------------------------- */
+long PN_FN(test)() {
+    long crc, n;
+
+#if PN_N > 16
+    PnHist = 0xFFFFFFFF;
+#else
+    PnHist = 0xFFFF;
+#endif
+    crc = 0xFFFF;
+    for (n = 0; n < PN_TEST; n++) { crc = crc16(crc, PN_FN(next)()); }
+    return crc;
+}
+
+/* --------------------------------------------------------
+ * PN_FN(sync_xxx)()
+ * - Seed-based lock, one received byte r per PN_FN(sync_cmp)():
+ *     LOAD  : the first PN_N received bits go straight into PnHist;
+ *             a register loaded from the line needs no luck to align.
+ *     VERIFY: then every byte must equal PN_FN(next)(), until
+ *             ThresError bits in a row have matched.
+ *   A mismatch in VERIFY starts LOAD again from the next byte.
+ * - The expected byte is made before r is there: PN_FN(sync_exp)()
+ *   puts it into PnExp.
+ * - AUTO_POL: both data polarities are tried on the same seed. For the
+ *   first VERIFY byte, PN_FN(sync_alt)() keeps the seed in PnSeed and
+ *   runs PN_FN(next)() on the inverted seed into SyncAlt first (an
+ *   inverted line then gives exactly ~SyncAlt); PN_FN(sync_swap)()
+ *   swaps the two registers back, so PnSeed holds the inverted one
+ *   (inverted seed + SyncAlt) and PnHist the seed for sync_exp. If r
+ *   is ~SyncAlt, DataMask is flipped and PnSeed is the register in
+ *   step.
+ *   Every 256 bytes without lock the clock edge is flipped as well.
+ * - Clean line: locks after ceil(PN_N/8) + ceil(ThresError/8) bytes.
+ * - sync_cmp returns TRUE once locked; PnHist is then in step with
+ *   the line.
+ * -------------------------------------------------------- */
+void PN_FN(sync_alt)() {
+#if AUTO_POL
+    if (SyncLoad < PN_N || RenzokuError) { return; }
+    PnSeed  = PnHist;
+    PnHist  = ~PnHist;
+    SyncAlt = PN_FN(next)();
+#endif
+}
+
+void PN_FN(sync_swap)() {
+#if AUTO_POL
+    if (SyncLoad < PN_N || RenzokuError) { return; }
+    PnHist ^= PnSeed;
+    PnSeed ^= PnHist;
+    PnHist ^= PnSeed;
+#endif
+}
+
+void PN_FN(sync_exp)() {
+    if (SyncLoad >= PN_N) { PnExp = PN_FN(next)(); }
+}
+
+short PN_FN(sync_cmp)(int r) {
+    r ^= DataMask;
+
+#if AUTO_POL
+    if (++SyncTry == 0) {
+        clock_flip();
+        SyncLoad = 0;
+        RenzokuError = 0;
+        return FALSE;
+    }
+#endif
+
+    if (SyncLoad < PN_N) {
+        PnHist = (PnHist << 8) | r;
+        SyncLoad += 8;
+        return FALSE;
+    }
+
+    if (r != PnExp) {
+#if AUTO_POL
+        if (RenzokuError == 0 && (r ^ SyncAlt) == 0xFF) {
+            PnHist = PnSeed;
+            DataMask ^= 0xFF;
+        } else
+#endif
+        {
+            SyncLoad = 0;
+            RenzokuError = 0;
+            return FALSE;
+        }
+    }
+
+    if (ThresError - RenzokuError <= 8) { return TRUE; }
+    RenzokuError += 8;
+    return FALSE;
+}
+#endif
+
+/* --------------------------------------------------------
+ * PN_FN(sync)()
+ * - One received byte r through all the sync steps at once (the
+ *   engines without gaps to spread them over). PN_FN(lock)() runs one
+ *   step per gap between the bits of the next byte instead:
+ *     gap 1  PN_FN(sync_alt)()   AUTO_POL, first VERIFY byte
+ *     gap 2  PN_FN(sync_swap)()  the same byte
+ *     gap 3  PN_FN(sync_exp)()   VERIFY: PnExp
+ *     gap 6  TIME_POLL()         seconds run on during sync
+ *     gap 8  PN_FN(sync_cmp)()   LOAD, or the compare
+ *   The steps see the state sync_cmp left after the last byte, so
+ *   both orders give the same lock.
+ * - Returns TRUE once locked.
+ * -------------------------------------------------------- */
+short PN_FN(sync)(int r) {
+    TIME_POLL();
+    PN_FN(sync_alt)();
+    PN_FN(sync_swap)();
+    PN_FN(sync_exp)();
+    return PN_FN(sync_cmp)(r);
+}
+
+#if BERT_ENGINE == ENGINE_TMR0
+/* --------------------------------------------------------
+ * PN_FN(count)()   (ENGINE_TMR0)
+ * - clk_isr() only packs bits into RxRing[]; both phases run here,
+ *   one queued byte at a time.
+ * - relock(): loss of sync goes back to the sync phase.
+ * -------------------------------------------------------- */
+void PN_FN(count)() {
+    do {
+        while (!PN_FN(sync)(rx_get()));
+
+        on_lock();
+
+        PnExp = PN_FN(next)();
+        INJ_BYTE(PnExp);
+        while (!rx_byte(rx_get())) {
+            PnExp = PN_FN(next)();
+            INJ_BYTE(PnExp);
+        }
+    } while (relock());
+}
+#else
+#if USE_CAP
+/* --------------------------------------------------------
+ * PN_FN(cap)()   (MODE_CAP)
+ * - Per burst: cap_fill(), then sync from the start of CapBuf[] and
+ *   count the rest of it with rx_byte(), exactly as the live engine.
+ * - A clean line locks in ceil(PN_N/8) + ceil(ThresError/8) bytes;
+ *   a burst that does not lock counts nothing.
+ * - AUTO_POL: a lock clears SyncTry, so only the sync bytes of bursts
+ *   that fail add up to clock_flip() (256 of them).
+ * - rx_byte() TRUE: end of the block, or loss of sync (relock(), the
+ *   next burst goes on).
+ * -------------------------------------------------------- */
+void PN_FN(cap)() {
+    int i;
+    short locked;
+
+    while (TRUE) {
+        cap_next();
+        cap_fill();
+
+        locked = FALSE;
+        i = 0;
+        while (!locked && i < CAP_LEN) {
+            locked = PN_FN(sync)(CapBuf[i++]);
+        }
+        if (!locked) { continue; }
+#if AUTO_POL
+        SyncTry = 0;                         // only bursts that fail count
+#endif
+
+        on_lock();
+        while (i < CAP_LEN) {
+            PnExp = PN_FN(next)();
+            INJ_BYTE(PnExp);
+            if (rx_byte(CapBuf[i++])) {
+                if (!relock()) { return; }
+                break;
+            }
+        }
+    }
+}
+#endif
+
+/* --------------------------------------------------------
+ * PN_FN(lock)()   (ENGINE_POLL)
+ * - Sync phase of PN_FN(count)() / PN_FN(lane)(): DATA_IN on every
+ *   CLK_IN edge until PN_FN(sync_cmp)() locks. The sync steps are
+ *   spread over the gaps between the bits as in PN_FN(sync)(), so the
+ *   byte gap only has OVR_MARK() and the compare; the caller's
+ *   on_lock() follows in the same gap.
+ * - USE_ASM: the #asm bit loops of BERT.c, whole bytes (RxLeft stays
+ *   8). The clock edge is read per byte: sync_cmp may flip it.
+ * -------------------------------------------------------- */
+void PN_FN(lock)() {
+#if USE_ASM
+    do {
+        if (ClockNeg) {
+            rx_bits_f(1);
+            PN_FN(sync_alt)();
+            rx_bits_f(1);
+            PN_FN(sync_swap)();
+            rx_bits_f(1);
+            PN_FN(sync_exp)();
+            rx_bits_f(3);
+            TIME_POLL();
+            rx_bits_f(2);
+        } else {
+            rx_bits_r(1);
+            PN_FN(sync_alt)();
+            rx_bits_r(1);
+            PN_FN(sync_swap)();
+            rx_bits_r(1);
+            PN_FN(sync_exp)();
+            rx_bits_r(3);
+            TIME_POLL();
+            rx_bits_r(2);
+        }
+        OVR_MARK();
+    } while (!PN_FN(sync_cmp)(RxByte));
+#else
+    short locked;
+
+    locked = FALSE;
+    while (!locked) {
+
+        // Wait for (logical) rising edge
+        while ( (!input(CLK_IN)) ^ ClockNeg );
+
+        shift_left(&RxByte, 1, input(DATA_IN));
+        if (--RxLeft == 0) {
+            RxLeft = 8;
+            OVR_MARK();
+            locked = PN_FN(sync_cmp)(RxByte);
+        }
+        else if (RxLeft == 7) { PN_FN(sync_alt)(); }
+        else if (RxLeft == 6) { PN_FN(sync_swap)(); }
+        else if (RxLeft == 5) { PN_FN(sync_exp)(); }
+        else if (RxLeft == 2) { TIME_POLL(); }
+
+        // Wait for (logical) falling edge / clock low
+        while ( (input(CLK_IN)) ^ ClockNeg );
+    }
+#endif
+}
+
+#if USE_LANE
+/* --------------------------------------------------------
+ * PN_FN(lane)()   (MODE_LANE)
+ * - DATA_IN is the reference lane: sync, rx_byte(), loss of sync and
+ *   the end of the run as in the C loop of PN_FN(count)().
+ * - RB4..RB7: one PORTB read per clock, one XOR against the expected
+ *   bit broadcast to all lanes (m = LANE_PINS for a 1, 0 for a 0);
+ *   only a wrong lane costs more (lane_err()). m is made before the
+ *   edge wait, so the edge to PORTB path is the same as for DATA_IN
+ *   plus one read.
+ * - A slip of DATA_IN is taken back from ErrorBits only; the lanes
+ *   keep what they counted meanwhile.
+ * -------------------------------------------------------- */
+void PN_FN(lane)() {
+    int e, m;
+
+    do {
+        PN_FN(lock)();
+        on_lock();
+
+        PnExp = PN_FN(next)();
+        INJ_BYTE(PnExp);
+        LaneExp = PnExp ^ DataMask;          // as on the line
+        PROF_START();
+
+        while (TRUE) {
+            m = 0;
+            if (bit_test(LaneExp, 7)) { m = LANE_PINS; }
+            LaneExp <<= 1;
+
+            while ( (!input(CLK_IN)) ^ ClockNeg );
+            PROF_END();
+
+            shift_left(&RxByte, 1, input(DATA_IN));
+            e = (PORTB ^ m) & LANE_PINS;
+            if (e) { lane_err(e); }
+
+            if (--RxLeft == 0) {
+                RxLeft = 8;
+                OVR_CHECK();
+                if (rx_byte(RxByte)) { break; }
+                PnExp = PN_FN(next)();
+                INJ_BYTE(PnExp);
+                LaneExp = PnExp ^ DataMask;
+            }
+
+            PROF_START();
+            while ( (input(CLK_IN)) ^ ClockNeg );
+        }
+    } while (relock());
+}
+#endif
+
+#if USE_NRZ
+/* --------------------------------------------------------
+ * PN_FN(nrz)()   (MODE_NRZ)
+ * - PN_FN(lock)() and the C count loop of PN_FN(count)() with
+ *   nrz_bit() in place of the two CLK_IN edge waits. The byte work
+ *   runs between two samples; nrz_bit() catches up after it.
+ * - No OVR_CHECK(): TMR0 has no clock to count.
+ * -------------------------------------------------------- */
+void PN_FN(nrz)() {
+    short locked, b;
+
+    do {
+        locked = FALSE;
+        while (!locked) {
+            b = nrz_bit();
+            shift_left(&RxByte, 1, b);
+            if (--RxLeft == 0) {
+                RxLeft = 8;
+                locked = PN_FN(sync)(RxByte);
+            }
+        }
+        on_lock();
+
+        PnExp = PN_FN(next)();
+        INJ_BYTE(PnExp);
+
+        while (TRUE) {
+            b = nrz_bit();
+            shift_left(&RxByte, 1, b);
+            if (--RxLeft == 0) {
+                RxLeft = 8;
+                if (rx_byte(RxByte)) { break; }
+                PnExp = PN_FN(next)();
+                INJ_BYTE(PnExp);
+            }
+        }
+    } while (relock());
+}
+#endif
+
+#if USE_GEN
+/* --------------------------------------------------------
+ * PN_FN(gen)()   (MODE_GEN, MODE_LOOP)
+ * - Sends PN_FN(next)() on GEN_DATA, oldest bit first, O.150 inverted
+ *   for the pn_inv[] polynomials. Per bit: GEN_DATA, GEN_EDGE(), read
+ *   DATA_IN, GEN_IDLE(); new data only after the sample, so the loop
+ *   may delay a bit by up to the GEN_EDGE() .. sample time (GEN_CLK:
+ *   one instruction; CLK_IN: up to a clock period).
+ * - MODE_LOOP: the byte just sent is PnExp for rx_byte(); a loopback
+ *   needs no sync, and the one LFSR advance serves TX and RX.
+ * - MODE_GEN: runs until SW_SEL (or 'X'), checked every 256 bytes.
+ * -------------------------------------------------------- */
+void PN_FN(gen)() {
+    int tx, inv, b;
+
+    inv = 0;
+    if (pn_inv[Poly]) { inv = 0xFF; }
+    PnHist = 0xFF;                           // any non-zero state
+    on_lock();
+    OVR_MARK();
+
+    while (TRUE) {
+        PnExp = PN_FN(next)();
+        tx = PnExp ^ inv;
+        INJ_BYTE(tx);                        // into the line, not PnExp
+        for (b = 0; b < 8; b++) {
+            output_bit(GEN_DATA, bit_test(tx, 7));
+            tx <<= 1;
+            GEN_EDGE();
+            shift_left(&RxByte, 1, input(DATA_IN));
+            GEN_IDLE();
+        }
+
+        if (Mode == MODE_GEN) {
+            if (++CountBytes.b[0] == 0) {
+                CARRY32(CountBytes);
+                if (input(SW_SEL) || uart_stop()) { break; }
+            }
+            continue;
+        }
+
+#ifndef GEN_CLK
+        OVR_CHECK();
+#endif
+        if (rx_byte(RxByte)) {
+            if (!relock()) { break; }
+            on_lock();                       // still in step: go on
+        }
+    }
+    output_low(GEN_DATA);
+}
+#endif
+
+/* --------------------------------------------------------
+ * PN_FN(count)()   (ENGINE_POLL)
+ * - The original two loops of countber(). Both now only shift DATA_IN
+ *   into RxByte per bit; every 8th bit goes to PN_FN(sync)() or
+ *   rx_cmp() with the taps as constants.
+ * - Count phase: the byte work is one step per gap between two bits
+ *   (bert_core.c, before rx_cmp()), so no gap pays for all of it. A
+ *   run or a count phase ends in the gap after the 7th bit of the
+ *   next byte (rx_end()); those bits only cost sync bits.
+ * - relock(): loss of sync goes back to the sync phase. The clock
+ *   edges missed meanwhile only cost sync bytes.
+ * - USE_OVR: TMR0 counts the same edges in hardware; every counted
+ *   byte checks that it moved by 8 (a missed edge is an overrun).
+ * - USE_ASM: the count phase uses the #asm bit loops of BERT.c, one
+ *   per clock edge; RxLeft stays 8 (whole bytes only).
+ * - POLL_LIVE: LIVE_POLL() after the 5th bit of every byte, before
+ *   rx_early() (the live screen, poll_step(): it leaves the bytes with
+ *   a queued error bit to rx_early()).
+ * - USE_PROF: PROF_START() / PROF_END() time the two edge waits of
+ *   every bit of the C loop (spare cycles, see prof_init()).
+ * - MODE_CAP: PN_FN(cap)() instead, MODE_GEN / MODE_LOOP: PN_FN(gen)(),
+ *   MODE_LANE: PN_FN(lane)(), MODE_NRZ: PN_FN(nrz)().
+ * -------------------------------------------------------- */
+void PN_FN(count)() {
+#if USE_CAP
+    if (Mode == MODE_CAP) {
+        PN_FN(cap)();
+        return;
+    }
+#endif
+#if USE_GEN
+    if (Mode == MODE_GEN || Mode == MODE_LOOP) {
+        PN_FN(gen)();
+        return;
+    }
+#endif
+#if USE_LANE
+    if (Mode == MODE_LANE) {
+        PN_FN(lane)();
+        return;
+    }
+#endif
+#if USE_NRZ
+    if (Mode == MODE_NRZ) {
+        PN_FN(nrz)();
+        return;
+    }
+#endif
+
+    do {
+        /* -------- Sync phase -------- */
+        PN_FN(lock)();
+
+        on_lock();
+
+        /* -------- Count phase -------- */
+#if USE_ASM
+        // #asm bit loops; the byte work is spread over the eight gaps
+        if (ClockNeg) {
+            do {
+                rx_bits_f(1);
+                PnExp = PN_FN(next)();
+                INJ_BYTE(PnExp);
+                rx_bits_f(1);
+                rx_err();
+                rx_bits_f(1);
+                rx_los();
+                rx_bits_f(1);
+                rx_wrap();
+                rx_bits_f(1);
+                LIVE_POLL();
+                rx_early();
+                rx_bits_f(1);
+                rx_time();
+                rx_bits_f(1);
+                if (rx_end()) { break; }
+                rx_bits_f(1);
+                OVR_CHECK();
+                rx_cmp(RxByte);
+            } while (TRUE);
+        } else {
+            do {
+                rx_bits_r(1);
+                PnExp = PN_FN(next)();
+                INJ_BYTE(PnExp);
+                rx_bits_r(1);
+                rx_err();
+                rx_bits_r(1);
+                rx_los();
+                rx_bits_r(1);
+                rx_wrap();
+                rx_bits_r(1);
+                LIVE_POLL();
+                rx_early();
+                rx_bits_r(1);
+                rx_time();
+                rx_bits_r(1);
+                if (rx_end()) { break; }
+                rx_bits_r(1);
+                OVR_CHECK();
+                rx_cmp(RxByte);
+            } while (TRUE);
+        }
+#else
+        PROF_START();
+
+        // One step of the byte work per bit, see rx_cmp() in bert_core.c
+        while (TRUE) {
+
+            while ( (!input(CLK_IN)) ^ ClockNeg );
+            PROF_END();                      // USE_PROF: both waits of this bit
+
+            shift_left(&RxByte, 1, input(DATA_IN));
+            if (--RxLeft == 0) {
+                RxLeft = 8;
+                OVR_CHECK();                 // TMR0 saw 8 edges too?
+                rx_cmp(RxByte);
+            }
+            else if (RxLeft == 7) {
+                PnExp = PN_FN(next)();       // LFSR advance (once per 8 clocks)
+                INJ_BYTE(PnExp);
+            }
+            else if (RxLeft == 6) { rx_err(); }
+            else if (RxLeft == 5) { rx_los(); }
+            else if (RxLeft == 4) { rx_wrap(); }
+            else if (RxLeft == 3) {
+                LIVE_POLL();
+                rx_early();
+            }
+            else if (RxLeft == 2) { rx_time(); }
+            else if (rx_end())    { break; }
+
+            PROF_START();
+            while ( (input(CLK_IN)) ^ ClockNeg );
+        }
+#endif
+    } while (relock());
+}
+#endif
+
+#undef PN_H
+#undef PN_TEST
+#undef PN_N
+#undef PN_K
+#undef PN_FN
+#undef PN_WORD
@@ -0,0 +1,101 @@
+/*
+ * serial.c
+ * Interrupt-driven USART for BERT.c (CCS C), RB1 = RX, RB2 = TX.
+ * Needs #use rs232(...) on the hardware pins before it is included.
+ *
+ * Both directions go through small rings, so neither printf() nor the
+ * host ever waits for the other byte by byte:
+ *
+ *   ser_init()   : rings empty, RX interrupt on
+ *   ser_putc(c)  : printf() sink; waits only while the TX ring is full
+ *   ser_room()   : free bytes in the TX ring (check before sending
+ *                  from code that must not wait)
+ *   ser_kbhit()  : a received character is queued
+ *   ser_getc()   : next received character
+ */
+
+#define TX_RING   32         // power of 2
+#define TX_MASK   (TX_RING - 1)
+#define RXC_RING  8          // power of 2
+#define RXC_MASK  (RXC_RING - 1)
+
+int  TxRing[TX_RING];
+int  TxHead;                 // written by ser_putc()
+int  TxTail;                 // written by ser_tx_isr()
+int  RxcRing[RXC_RING];
+int  RxcHead;                // written by ser_rx_isr()
+int  RxcTail;                // written by ser_getc()
+
+/* --------------------------------------------------------
+ * ser_rx_isr()
+ * - Queues the received character; dropped if the ring is full.
+ * -------------------------------------------------------- */
+#int_rda
+void ser_rx_isr() {
+    int c, n;
+
+    c = getc();
+    n = (RxcHead + 1) & RXC_MASK;
+    if (n != RxcTail) {
+        RxcRing[RxcHead] = c;
+        RxcHead = n;
+    }
+}
+
+/* --------------------------------------------------------
+ * ser_tx_isr()
+ * - TXREG empty: next queued character, or TX interrupt off when
+ *   the ring is empty (ser_putc() turns it on again).
+ * -------------------------------------------------------- */
+#int_tbe
+void ser_tx_isr() {
+    if (TxTail == TxHead) {
+        disable_interrupts(INT_TBE);
+        return;
+    }
+    putc(TxRing[TxTail]);
+    TxTail = (TxTail + 1) & TX_MASK;
+}
+
+/* --------------------------------------------------------
+ * ser_init()
+ * -------------------------------------------------------- */
+void ser_init() {
+    TxHead  = 0;
+    TxTail  = 0;
+    RxcHead = 0;
+    RxcTail = 0;
+    enable_interrupts(INT_RDA);
+}
+
+/* --------------------------------------------------------
+ * ser_putc()
+ * - Waits for room only when the ring is full, which needs
+ *   interrupts on (GLOBAL).
+ * -------------------------------------------------------- */
+void ser_putc(char c) {
+    int n;
+
+    n = (TxHead + 1) & TX_MASK;
+    while (n == TxTail);
+
+    TxRing[TxHead] = c;
+    TxHead = n;
+    enable_interrupts(INT_TBE);
+}
+
+int ser_room() {
+    return (TxTail - TxHead - 1) & TX_MASK;
+}
+
+short ser_kbhit() {
+    return (RxcTail != RxcHead);
+}
+
+int ser_getc() {
+    int c;
+
+    c = RxcRing[RxcTail];
+    RxcTail = (RxcTail + 1) & RXC_MASK;
+    return c;
+}